@@ -25,10 +25,14 @@ class ExpressionModelForm(forms.ModelForm):
         TRANSACTION_TYPE, MERCHANT_CATEGORY, LOCATION, DEVICE_USED, PAYMENT_CHANNEL, IP_ADDRESS, DEVICE_HASH, TIME<br>
         <strong>Операторы сравнения:</strong> >, <, >=, <=, =, ==, !=<br>
         <strong>Логические операторы:</strong> AND, OR, NOT<br>
-        <strong>Агрегатные функции:</strong> COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT<br>
+        <strong>Агрегатные функции:</strong> COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT, PERCENTILE, MEDIAN,
+        DECAYED_RATE, DECAYED_MEAN, DECAYED_STD, DECAYED_FREQUENCY (второй аргумент — период полураспада в секундах)<br>
         <strong>Примеры:</strong><br>
         - THRESHOLD: <code>AMOUNT > 1000</code><br>
         - PATTERN: <code>COUNT(AMOUNT) > 5</code><br>
+        - PATTERN по устройству для всех счетов: <code>COUNT(*) BY DEVICE_HASH > 5</code><br>
+        - PATTERN выше 99-го перцентиля счёта: <code>PERCENTILE(AMOUNT, 99) < AMOUNT</code><br>
+        - PATTERN редкая локация за сутки: <code>DECAYED_FREQUENCY(LOCATION, 86400) < 0.05</code><br>
         - COMPOSITE: <code>AMOUNT > 100 AND TIME = 'night'</code><br>
         <em>Все названия полей должны быть в ВЕРХНЕМ регистре!</em>
         """
@@ -168,13 +172,20 @@ class PatternRuleModelForm(ExpressionModelForm):
     )
     max_count = forms.IntegerField(
         label="Максимальное количество",
-        min_value=1,
-        help_text="Максимальное количество транзакций, соответствующих паттерну"
+        min_value=0,
+        help_text="Максимальное количество транзакций, соответствующих паттерну (0 — без ограничения)"
+    )
+    distinct_precision = forms.IntegerField(
+        label="Точность COUNT_DISTINCT",
+        min_value=0,
+        max_value=14,
+        initial=0,
+        help_text="Точность HyperLogLog для COUNT_DISTINCT (4–14, 14 — около 0.8% ошибки); 0 — точный подсчёт"
     )
     
     class Meta(ExpressionModelForm.Meta):
         model = PatternRule
-        fields = ('max_delta_time', 'max_count', 'expression_text')
+        fields = ('max_delta_time', 'max_count', 'distinct_precision', 'expression_text')
     
     def __init__(self, *args, **kwargs):
         # По умолчанию для PATTERN правил
@@ -186,7 +197,7 @@ class PatternRuleModelForm(ExpressionModelForm):
 class PatternRuleAdmin(BaseRuleAdmin):
     RULE_TYPE = "PATTERN"
     form = PatternRuleModelForm
-    fields = ('max_delta_time', 'max_count', 'expression_text')
+    fields = ('max_delta_time', 'max_count', 'distinct_precision', 'expression_text')
 
 
 @admin.register(Profile)
@@ -12,12 +12,13 @@ class Lexer:
         ('NUMBER',       r'\d+(\.\d*)?'),
         ('STRING',       r"'[^']*'|\"[^\"]*\""),  
         ('BOOL',         r'TRUE|FALSE'),
-        ('AGG_FUNCTION', r'COUNT_DISTINCT|COUNT|SUM|AVG|MIN|MAX'),
+        ('AGG_FUNCTION', r'COUNT_DISTINCT|COUNT|SUM|AVG|MIN|MAX|PERCENTILE|MEDIAN|DECAYED_RATE|DECAYED_MEAN|DECAYED_STD|DECAYED_FREQUENCY'),
         ('FIELD',        r'TRANSACTION_ID|SENDER_ACCOUNT|TIMESTAMP|RECEIVER_ACCOUNT|AMOUNT|TRANSACTION_TYPE|MERCHANT_CATEGORY|LOCATION|DEVICE_USED|PAYMENT_CHANNEL|IP_ADDRESS|DEVICE_HASH|TIME'),
         ('LOGIC_OP',     r'AND|OR|NOT'),
         ('COMP_OP',      r'==|!=|>=|<=|>|<|='),  
         ('LPAREN',       r'\('),
         ('RPAREN',       r'\)'),
+        ('COMMA',        r','),
         ('WILDCARD',     r'\*'),  # Добавляем токен для *, должен быть после скобок
         ('IDENTIFIER',   r'[A-Za-z_][A-Za-z0-9_]*'), 
         ('SKIP',         r'[ \t\n\r]+'),  
@@ -65,7 +66,9 @@ class Parser:
     LOGIC_OP_MAP = {"AND": "AND", "OR": "OR", "NOT": "NOT"}
     AGG_FUNC_MAP = {
         "COUNT": "COUNT", "SUM": "SUM", "AVG": "AVG", "MIN": "MIN", "MAX": "MAX", 
-        "COUNT_DISTINCT": "COUNT_DISTINCT"
+        "COUNT_DISTINCT": "COUNT_DISTINCT", "PERCENTILE": "PERCENTILE", "MEDIAN": "MEDIAN",
+        "DECAYED_RATE": "DECAYED_RATE", "DECAYED_MEAN": "DECAYED_MEAN", "DECAYED_STD": "DECAYED_STD",
+        "DECAYED_FREQUENCY": "DECAYED_FREQUENCY"
     }
 
     def _build_logical(self, left, op_token, right):
@@ -114,8 +117,30 @@ class Parser:
                 if "field" not in operand_node and "wildcard" not in operand_node:
                     raise ValueError("Aggregate function argument must be a field or '*' (e.g., AMOUNT or *).")
             
+            aggregate = {"function": self.AGG_FUNC_MAP[func_token.value], "operand": operand_node}
+
+            # PERCENTILE(AMOUNT, 99): второй аргумент — перцентиль от 0 до 100
+            if func_token.value == 'PERCENTILE':
+                self.consume('COMMA')
+                percentile = float(self.consume('NUMBER').value)
+                if not 0 <= percentile <= 100:
+                    raise ValueError("PERCENTILE must be between 0 and 100 (e.g., PERCENTILE(AMOUNT, 99)).")
+                aggregate["percentile"] = percentile
+            # DECAYED_MEAN(AMOUNT, 86400): второй аргумент — период полураспада в секундах
+            elif func_token.value.startswith('DECAYED_'):
+                self.consume('COMMA')
+                half_life = float(self.consume('NUMBER').value)
+                if not half_life.is_integer() or half_life <= 0:
+                    raise ValueError("Half-life must be a positive number of seconds (e.g., DECAYED_RATE(*, 3600)).")
+                aggregate["half_life"] = int(half_life)
             self.consume('RPAREN')
-            return {"aggregate": {"function": self.AGG_FUNC_MAP[func_token.value], "operand": operand_node}}
+
+            # Необязательная группировка: COUNT(*) BY DEVICE_HASH
+            token = self.peek()
+            if token and token.type == 'IDENTIFIER' and token.value == 'BY':
+                self.consume()
+                aggregate["group_by"] = {"field": self.consume('FIELD').value}
+            return {"aggregate": aggregate}
         elif token.type == 'LPAREN':
             self.consume('LPAREN')
             node = self.parse_logical_expression()
@@ -188,11 +213,11 @@ class Parser:
                 op_token = self.consume()
                 right_node = self.parse_atom()
                 
-                # Проверяем, что правая часть - это литерал (число или строка)
-                if "literal" not in right_node:
+                # Правая часть - литерал или поле текущей транзакции
+                if "literal" not in right_node and "field" not in right_node:
                     raise ValueError(
-                        "PATTERN rule right side must be a literal value (number or string), not a field.\n"
-                        "Пример: COUNT(AMOUNT) > 5 (не COUNT(AMOUNT) > OTHER_FIELD)"
+                        "PATTERN rule right side must be a literal value or a field of the transaction.\n"
+                        "Пример: COUNT(AMOUNT) > 5 или PERCENTILE(AMOUNT, 99) < AMOUNT"
                     )
                 
                 result_node = {"comparison": {"operator": self.COMP_OP_MAP[op_token.value], "left": left_node, "right": right_node}}
@@ -278,7 +303,7 @@ class RuleParser:
             # PATTERN должен содержать хотя бы одну агрегатную функцию
             if not any(t.type == 'AGG_FUNCTION' for t in tokens):
                 raise ValueError(
-                    "PATTERN rule must contain at least one aggregate function (COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT).\n"
+                    "PATTERN rule must contain at least one aggregate function (COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT, PERCENTILE, MEDIAN, DECAYED_*).\n"
                     "Пример: COUNT(AMOUNT) > 5 или SUM(AMOUNT) >= 1000"
                 )
             # PATTERN должен содержать хотя бы один оператор сравнения
@@ -52,6 +52,7 @@ def send_profiles_to_director(profiles_queryset):
                         elif isinstance(rule, PatternRule):
                             grpc_config.pattern_rule.max_delta_time = rule.max_delta_time
                             grpc_config.pattern_rule.max_count = rule.max_count
+                            grpc_config.pattern_rule.distinct_precision = rule.distinct_precision
                             print(f"    Converting pattern expression: {rule.expression}")
                             try:
                                 json_format.ParseDict(rule.expression, grpc_config.pattern_rule.expression)
@@ -0,0 +1,16 @@
+from django.db import migrations, models
+
+
+class Migration(migrations.Migration):
+
+    dependencies = [
+        ('myapp', '0002_ruleresult'),
+    ]
+
+    operations = [
+        migrations.AddField(
+            model_name='patternrule',
+            name='distinct_precision',
+            field=models.IntegerField(default=0),
+        ),
+    ]
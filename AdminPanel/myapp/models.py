@@ -33,6 +33,7 @@ class PatternRule(models.Model):
     max_delta_time = models.IntegerField()
     max_count = models.IntegerField()
     expression = models.JSONField()
+    distinct_precision = models.IntegerField(default=0)
 
     def __str__(self):
         return str(self.expression)
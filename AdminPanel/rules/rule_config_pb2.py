@@ -24,7 +24,7 @@ _sym_db = _symbol_database.Default()
 
 
 
-DESCRIPTOR = _descriptor_pool.Default().AddSerializedFile(b'\n\x17rules/rule_config.proto\x12\x05rules\"\xf1\x01\n\nExpression\x12&\n\x05\x66ield\x18\x01 \x01(\x0b\x32\x15.rules.FieldReferenceH\x00\x12&\n\x07literal\x18\x02 \x01(\x0b\x32\x13.rules.LiteralValueH\x00\x12-\n\taggregate\x18\x03 \x01(\x0b\x32\x18.rules.AggregateFunctionH\x00\x12\x30\n\ncomparison\x18\x04 \x01(\x0b\x32\x1a.rules.ComparisonOperationH\x00\x12*\n\x07logical\x18\x05 \x01(\x0b\x32\x17.rules.LogicalOperationH\x00\x42\x06\n\x04\x65xpr\"\xa9\x02\n\x0e\x46ieldReference\x12.\n\x05\x66ield\x18\x01 \x01(\x0e\x32\x1f.rules.FieldReference.FieldType\"\xe6\x01\n\tFieldType\x12\x12\n\x0eTRANSACTION_ID\x10\x00\x12\x12\n\x0eSENDER_ACCOUNT\x10\x01\x12\r\n\tTIMESTAMP\x10\x02\x12\x14\n\x10RECEIVER_ACCOUNT\x10\x03\x12\n\n\x06\x41MOUNT\x10\x04\x12\x14\n\x10TRANSACTION_TYPE\x10\x05\x12\x15\n\x11MERCHANT_CATEGORY\x10\x06\x12\x0c\n\x08LOCATION\x10\x07\x12\x0f\n\x0b\x44\x45VICE_USED\x10\x08\x12\x13\n\x0fPAYMENT_CHANNEL\x10\t\x12\x0e\n\nIP_ADDRESS\x10\n\x12\x0f\n\x0b\x44\x45VICE_HASH\x10\x0b\"q\n\x0cLiteralValue\x12\x16\n\x0cstring_value\x18\x01 \x01(\tH\x00\x12\x15\n\x0b\x66loat_value\x18\x02 \x01(\x02H\x00\x12\x13\n\tint_value\x18\x03 \x01(\x05H\x00\x12\x14\n\nbool_value\x18\x04 \x01(\x08H\x00\x42\x07\n\x05value\"\xd4\x01\n\x11\x41ggregateFunction\x12\x38\n\x08\x66unction\x18\x01 \x01(\x0e\x32&.rules.AggregateFunction.AggregateType\x12\"\n\x07operand\x18\x02 \x01(\x0b\x32\x11.rules.Expression\x12\r\n\x05\x61lias\x18\x03 \x01(\t\"R\n\rAggregateType\x12\t\n\x05\x43OUNT\x10\x00\x12\x07\n\x03SUM\x10\x01\x12\x07\n\x03\x41VG\x10\x02\x12\x07\n\x03MIN\x10\x03\x12\x07\n\x03MAX\x10\x04\x12\x12\n\x0e\x43OUNT_DISTINCT\x10\x05\"\x89\x02\n\x13\x43omparisonOperation\x12\x35\n\x08operator\x18\x01 \x01(\x0e\x32#.rules.ComparisonOperation.Operator\x12\x1f\n\x04left\x18\x02 \x01(\x0b\x32\x11.rules.Expression\x12 \n\x05right\x18\x03 \x01(\x0b\x32\x11.rules.Expression\"x\n\x08Operator\x12\t\n\x05\x45QUAL\x10\x00\x12\r\n\tNOT_EQUAL\x10\x01\x12\x10\n\x0cGREATER_THAN\x10\x02\x12\x19\n\x15GREATER_THAN_OR_EQUAL\x10\x03\x12\r\n\tLESS_THAN\x10\x04\x12\x16\n\x12LESS_THAN_OR_EQUAL\x10\x05\"\x91\x01\n\x10LogicalOperation\x12\x32\n\x08operator\x18\x01 \x01(\x0e\x32 .rules.LogicalOperation.Operator\x12#\n\x08operands\x18\x02 \x03(\x0b\x32\x11.rules.Expression\"$\n\x08Operator\x12\x07\n\x03\x41ND\x10\x00\x12\x06\n\x02OR\x10\x01\x12\x07\n\x03NOT\x10\x02\"6\n\rCompositeRule\x12%\n\nexpression\x18\x01 \x01(\x0b\x32\x11.rules.Expression\"1\n\x06MLRule\x12\x12\n\nmodel_uuid\x18\x01 \x01(\t\x12\x13\n\x0blower_bound\x18\x02 \x01(\x01\"_\n\x0bPatternRule\x12\x16\n\x0emax_delta_time\x18\x01 \x01(\x05\x12\x11\n\tmax_count\x18\x02 \x01(\x05\x12%\n\nexpression\x18\x03 \x01(\x0b\x32\x11.rules.Expression\"6\n\rThresholdRule\x12%\n\nexpression\x18\x01 \x01(\x0b\x32\x11.rules.Expression\"\xe1\x02\n\nRuleConfig\x12\x0c\n\x04uuid\x18\x01 \x01(\t\x12\x0c\n\x04name\x18\x02 \x01(\t\x12-\n\trule_type\x18\x03 \x01(\x0e\x32\x1a.rules.RuleConfig.RuleType\x12\x13\n\x0bis_critical\x18\x04 \x01(\x08\x12 \n\x07ml_rule\x18\x05 \x01(\x0b\x32\r.rules.MLRuleH\x00\x12.\n\x0e\x63omposite_rule\x18\x06 \x01(\x0b\x32\x14.rules.CompositeRuleH\x00\x12.\n\x0ethreshold_rule\x18\x07 \x01(\x0b\x32\x14.rules.ThresholdRuleH\x00\x12*\n\x0cpattern_rule\x18\x08 \x01(\x0b\x32\x12.rules.PatternRuleH\x00\"=\n\x08RuleType\x12\x06\n\x02ML\x10\x00\x12\r\n\tCOMPOSITE\x10\x01\x12\r\n\tTHRESHOLD\x10\x02\x12\x0b\n\x07PATTERN\x10\x03\x42\x06\n\x04ruleb\x06proto3')
+DESCRIPTOR = _descriptor_pool.Default().AddSerializedFile(b'\n\x17rules/rule_config.proto\x12\x05rules\"\xf1\x01\n\nExpression\x12&\n\x05\x66ield\x18\x01 \x01(\x0b\x32\x15.rules.FieldReferenceH\x00\x12&\n\x07literal\x18\x02 \x01(\x0b\x32\x13.rules.LiteralValueH\x00\x12-\n\taggregate\x18\x03 \x01(\x0b\x32\x18.rules.AggregateFunctionH\x00\x12\x30\n\ncomparison\x18\x04 \x01(\x0b\x32\x1a.rules.ComparisonOperationH\x00\x12*\n\x07logical\x18\x05 \x01(\x0b\x32\x17.rules.LogicalOperationH\x00\x42\x06\n\x04\x65xpr\"\xa9\x02\n\x0e\x46ieldReference\x12.\n\x05\x66ield\x18\x01 \x01(\x0e\x32\x1f.rules.FieldReference.FieldType\"\xe6\x01\n\tFieldType\x12\x12\n\x0eTRANSACTION_ID\x10\x00\x12\x12\n\x0eSENDER_ACCOUNT\x10\x01\x12\r\n\tTIMESTAMP\x10\x02\x12\x14\n\x10RECEIVER_ACCOUNT\x10\x03\x12\n\n\x06\x41MOUNT\x10\x04\x12\x14\n\x10TRANSACTION_TYPE\x10\x05\x12\x15\n\x11MERCHANT_CATEGORY\x10\x06\x12\x0c\n\x08LOCATION\x10\x07\x12\x0f\n\x0b\x44\x45VICE_USED\x10\x08\x12\x13\n\x0fPAYMENT_CHANNEL\x10\t\x12\x0e\n\nIP_ADDRESS\x10\n\x12\x0f\n\x0b\x44\x45VICE_HASH\x10\x0b\"q\n\x0cLiteralValue\x12\x16\n\x0cstring_value\x18\x01 \x01(\tH\x00\x12\x15\n\x0b\x66loat_value\x18\x02 \x01(\x02H\x00\x12\x13\n\tint_value\x18\x03 \x01(\x05H\x00\x12\x14\n\nbool_value\x18\x04 \x01(\x08H\x00\x42\x07\n\x05value\"\x8d\x03\n\x11\x41ggregateFunction\x12\x38\n\x08\x66unction\x18\x01 \x01(\x0e\x32&.rules.AggregateFunction.AggregateType\x12\"\n\x07operand\x18\x02 \x01(\x0b\x32\x11.rules.Expression\x12\r\n\x05\x61lias\x18\x03 \x01(\t\x12\'\n\x08group_by\x18\x04 \x01(\x0b\x32\x15.rules.FieldReference\x12\x12\n\npercentile\x18\x05 \x01(\x02\x12\x11\n\thalf_life\x18\x06 \x01(\x05\"\xba\x01\n\rAggregateType\x12\t\n\x05\x43OUNT\x10\x00\x12\x07\n\x03SUM\x10\x01\x12\x07\n\x03\x41VG\x10\x02\x12\x07\n\x03MIN\x10\x03\x12\x07\n\x03MAX\x10\x04\x12\x12\n\x0e\x43OUNT_DISTINCT\x10\x05\x12\x0e\n\nPERCENTILE\x10\x06\x12\n\n\x06MEDIAN\x10\x07\x12\x10\n\x0c\x44\x45\x43\x41YED_RATE\x10\x08\x12\x10\n\x0c\x44\x45\x43\x41YED_MEAN\x10\t\x12\x0f\n\x0b\x44\x45\x43\x41YED_STD\x10\n\x12\x15\n\x11\x44\x45\x43\x41YED_FREQUENCY\x10\x0b\"\x89\x02\n\x13\x43omparisonOperation\x12\x35\n\x08operator\x18\x01 \x01(\x0e\x32#.rules.ComparisonOperation.Operator\x12\x1f\n\x04left\x18\x02 \x01(\x0b\x32\x11.rules.Expression\x12 \n\x05right\x18\x03 \x01(\x0b\x32\x11.rules.Expression\"x\n\x08Operator\x12\t\n\x05\x45QUAL\x10\x00\x12\r\n\tNOT_EQUAL\x10\x01\x12\x10\n\x0cGREATER_THAN\x10\x02\x12\x19\n\x15GREATER_THAN_OR_EQUAL\x10\x03\x12\r\n\tLESS_THAN\x10\x04\x12\x16\n\x12LESS_THAN_OR_EQUAL\x10\x05\"\x91\x01\n\x10LogicalOperation\x12\x32\n\x08operator\x18\x01 \x01(\x0e\x32 .rules.LogicalOperation.Operator\x12#\n\x08operands\x18\x02 \x03(\x0b\x32\x11.rules.Expression\"$\n\x08Operator\x12\x07\n\x03\x41ND\x10\x00\x12\x06\n\x02OR\x10\x01\x12\x07\n\x03NOT\x10\x02\"6\n\rCompositeRule\x12%\n\nexpression\x18\x01 \x01(\x0b\x32\x11.rules.Expression\"1\n\x06MLRule\x12\x12\n\nmodel_uuid\x18\x01 \x01(\t\x12\x13\n\x0blower_bound\x18\x02 \x01(\x01\"{\n\x0bPatternRule\x12\x16\n\x0emax_delta_time\x18\x01 \x01(\x05\x12\x11\n\tmax_count\x18\x02 \x01(\x05\x12%\n\nexpression\x18\x03 \x01(\x0b\x32\x11.rules.Expression\x12\x1a\n\x12\x64istinct_precision\x18\x04 \x01(\x05\"6\n\rThresholdRule\x12%\n\nexpression\x18\x01 \x01(\x0b\x32\x11.rules.Expression\"\xe1\x02\n\nRuleConfig\x12\x0c\n\x04uuid\x18\x01 \x01(\t\x12\x0c\n\x04name\x18\x02 \x01(\t\x12-\n\trule_type\x18\x03 \x01(\x0e\x32\x1a.rules.RuleConfig.RuleType\x12\x13\n\x0bis_critical\x18\x04 \x01(\x08\x12 \n\x07ml_rule\x18\x05 \x01(\x0b\x32\r.rules.MLRuleH\x00\x12.\n\x0e\x63omposite_rule\x18\x06 \x01(\x0b\x32\x14.rules.CompositeRuleH\x00\x12.\n\x0ethreshold_rule\x18\x07 \x01(\x0b\x32\x14.rules.ThresholdRuleH\x00\x12*\n\x0cpattern_rule\x18\x08 \x01(\x0b\x32\x12.rules.PatternRuleH\x00\"=\n\x08RuleType\x12\x06\n\x02ML\x10\x00\x12\r\n\tCOMPOSITE\x10\x01\x12\r\n\tTHRESHOLD\x10\x02\x12\x0b\n\x07PATTERN\x10\x03\x42\x06\n\x04ruleb\x06proto3')
 
 _globals = globals()
 _builder.BuildMessageAndEnumDescriptors(DESCRIPTOR, _globals)
@@ -40,27 +40,27 @@ if not _descriptor._USE_C_DESCRIPTORS:
   _globals['_LITERALVALUE']._serialized_start=578
   _globals['_LITERALVALUE']._serialized_end=691
   _globals['_AGGREGATEFUNCTION']._serialized_start=694
-  _globals['_AGGREGATEFUNCTION']._serialized_end=906
-  _globals['_AGGREGATEFUNCTION_AGGREGATETYPE']._serialized_start=824
-  _globals['_AGGREGATEFUNCTION_AGGREGATETYPE']._serialized_end=906
-  _globals['_COMPARISONOPERATION']._serialized_start=909
-  _globals['_COMPARISONOPERATION']._serialized_end=1174
-  _globals['_COMPARISONOPERATION_OPERATOR']._serialized_start=1054
-  _globals['_COMPARISONOPERATION_OPERATOR']._serialized_end=1174
-  _globals['_LOGICALOPERATION']._serialized_start=1177
-  _globals['_LOGICALOPERATION']._serialized_end=1322
-  _globals['_LOGICALOPERATION_OPERATOR']._serialized_start=1286
-  _globals['_LOGICALOPERATION_OPERATOR']._serialized_end=1322
-  _globals['_COMPOSITERULE']._serialized_start=1324
-  _globals['_COMPOSITERULE']._serialized_end=1378
-  _globals['_MLRULE']._serialized_start=1380
-  _globals['_MLRULE']._serialized_end=1429
-  _globals['_PATTERNRULE']._serialized_start=1431
-  _globals['_PATTERNRULE']._serialized_end=1526
-  _globals['_THRESHOLDRULE']._serialized_start=1528
-  _globals['_THRESHOLDRULE']._serialized_end=1582
-  _globals['_RULECONFIG']._serialized_start=1585
-  _globals['_RULECONFIG']._serialized_end=1938
-  _globals['_RULECONFIG_RULETYPE']._serialized_start=1869
-  _globals['_RULECONFIG_RULETYPE']._serialized_end=1930
+  _globals['_AGGREGATEFUNCTION']._serialized_end=1091
+  _globals['_AGGREGATEFUNCTION_AGGREGATETYPE']._serialized_start=905
+  _globals['_AGGREGATEFUNCTION_AGGREGATETYPE']._serialized_end=1091
+  _globals['_COMPARISONOPERATION']._serialized_start=1094
+  _globals['_COMPARISONOPERATION']._serialized_end=1359
+  _globals['_COMPARISONOPERATION_OPERATOR']._serialized_start=1239
+  _globals['_COMPARISONOPERATION_OPERATOR']._serialized_end=1359
+  _globals['_LOGICALOPERATION']._serialized_start=1362
+  _globals['_LOGICALOPERATION']._serialized_end=1507
+  _globals['_LOGICALOPERATION_OPERATOR']._serialized_start=1471
+  _globals['_LOGICALOPERATION_OPERATOR']._serialized_end=1507
+  _globals['_COMPOSITERULE']._serialized_start=1509
+  _globals['_COMPOSITERULE']._serialized_end=1563
+  _globals['_MLRULE']._serialized_start=1565
+  _globals['_MLRULE']._serialized_end=1614
+  _globals['_PATTERNRULE']._serialized_start=1616
+  _globals['_PATTERNRULE']._serialized_end=1739
+  _globals['_THRESHOLDRULE']._serialized_start=1741
+  _globals['_THRESHOLDRULE']._serialized_end=1795
+  _globals['_RULECONFIG']._serialized_start=1798
+  _globals['_RULECONFIG']._serialized_end=2151
+  _globals['_RULECONFIG_RULETYPE']._serialized_start=2082
+  _globals['_RULECONFIG_RULETYPE']._serialized_end=2143
 # @@protoc_insertion_point(module_scope)
@@ -36,14 +36,14 @@ namespace director_service {
 Director::Director(
     std::string topic,
     const userver::kafka::Producer& producer)
-  : _topic(std::move(topic)), _producer(producer)
+  : _topic(std::move(topic)), _producer(producer), _profiles(std::make_shared<const ProfileContainer>())
     {
 }
 
 void Director::UpdateProfiles(Director::ProfileContainer profiles) {
-    LOG_INFO() << "Old profiles count: " << _profiles.size();
-    _profiles = std::move(profiles);
-    LOG_INFO() << "New profiles count: " << _profiles.size();
+    LOG_INFO() << "Old profiles count: " << _profiles->size();
+    _profiles = std::make_shared<const ProfileContainer>(std::move(profiles));
+    LOG_INFO() << "New profiles count: " << _profiles->size();
 }
 
 
@@ -52,12 +52,12 @@ void Director::ProcessTransaction(
   userver::engine::TaskProcessor& task_processor
 ) const {
     userver::engine::DetachUnscopedUnsafe(userver::engine::AsyncNoSpan(task_processor,
-    [topic = _topic, transaction = transaction, profiles = _profiles, &producer = _producer]() mutable -> void {
+    [topic = _topic, transaction = std::move(transaction), profiles = _profiles, &producer = _producer]() mutable -> void {
         LOG_INFO()
              << fmt::format("Director start transaction processing process: transaction_id: {}, profiles_count: {}",
-                    transaction.transaction_id(), profiles.size());
+                    transaction.transaction_id(), profiles->size());
 
-        for (auto profile : profiles) {
+        for (auto profile : *profiles) {
             auto [produce_count, produce_result] = kRuleRequestProducer(topic, producer, profile, transaction);
             if (produce_result != RuleRequestProducer::SendStatus::kSuccess) {
                 LOG_ERROR()
@@ -74,6 +74,40 @@ void Director::ProcessTransaction(
     }));
 }
 
+void Director::ProcessTransactions(
+  std::vector<transaction::Transaction>&& transactions,
+  userver::engine::TaskProcessor& task_processor
+) const {
+    userver::engine::DetachUnscopedUnsafe(userver::engine::AsyncNoSpan(task_processor,
+    [topic = _topic, transactions = std::move(transactions), profiles = _profiles, &producer = _producer]() -> void {
+        LOG_INFO()
+             << fmt::format("Director start batch processing process: transactions_count: {}, profiles_count: {}",
+                    transactions.size(), profiles->size());
+
+        std::vector<const profile::Profile*> batch_profiles;
+        size_t config_count = 0;
+        batch_profiles.reserve(profiles->size());
+        for (const auto& profile : *profiles) {
+            batch_profiles.push_back(&profile);
+            config_count += profile.rules().size();
+        }
+
+        auto [produce_count, produce_result] = kRuleRequestProducer(topic, producer, batch_profiles, transactions);
+        if (produce_result != RuleRequestProducer::SendStatus::kSuccess) {
+            LOG_ERROR()
+                << fmt::format(
+                    "Batch producing error: {} from {}, produce_status: {}",
+                        produce_count, transactions.size() * config_count,
+                        produce_result == RuleRequestProducer::SendStatus::kErrorRetryable ? "retryable" : "nonretryable"
+                );
+        }
+        LOG_INFO()
+                << fmt::format("Produce batch: transactions_count: {}, profiles_count: {}, config_count: {}",
+                    transactions.size(), batch_profiles.size(), config_count);
+        LOG_INFO() << "Director end batch processing process";
+    }));
+}
+
 
 DirectorComponent::DirectorComponent(
     const userver::components::ComponentConfig& config,
@@ -116,6 +150,16 @@ DirectorComponent::ProcessTransactionCallableType DirectorComponent::GetProcessT
     };
 }
 
+DirectorComponent::ProcessTransactionsCallableType DirectorComponent::GetProcessTransactionsCallable() const {
+    return [this](std::vector<transaction::Transaction>&& transactions) {
+        LOG_INFO() << "Director start batch processing";
+        {
+            std::unique_lock<userver::engine::Mutex> lk {_u_mx};
+            _director.ProcessTransactions(std::move(transactions), _task_processor);
+        }
+    };
+}
+
 DirectorComponent::UpdateProfilesCallableType DirectorComponent::GetUpdateProfilesCallable() {
     return [this](Director::ProfileContainer profiles) {
         LOG_INFO() << "Director start profile updating";
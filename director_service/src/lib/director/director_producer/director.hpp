@@ -2,9 +2,11 @@
 
 // stdcpp
 #include <functional>
+#include <memory>
 #include <string_view>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 //userver
 #include <userver/components/component_base.hpp>
@@ -57,12 +59,19 @@ public:
         transaction::Transaction&& transaction,
         userver::engine::TaskProcessor& _task_processor
     ) const;
+    // One task and one Kafka fan-out for the whole batch.
+    void ProcessTransactions(
+        std::vector<transaction::Transaction>&& transactions,
+        userver::engine::TaskProcessor& _task_processor
+    ) const;
     void UpdateProfiles(ProfileContainer profiles);
 
 private:
     std::string _topic;
     const userver::kafka::Producer& _producer;
-    ProfileContainer _profiles;
+    // replaced as a whole on update, so processing tasks share the snapshot
+    // they started with instead of copying it
+    std::shared_ptr<const ProfileContainer> _profiles;
 };
 
 
@@ -81,10 +90,12 @@ public:
 
 public:
     using ProcessTransactionCallableType = std::function<void(transaction::Transaction&&)>;
+    using ProcessTransactionsCallableType = std::function<void(std::vector<transaction::Transaction>&&)>;
     using UpdateProfilesCallableType = std::function<void(Director::ProfileContainer)>;
 
 public:
     ProcessTransactionCallableType GetProcessTransactionCallable() const;
+    ProcessTransactionsCallableType GetProcessTransactionsCallable() const;
     UpdateProfilesCallableType GetUpdateProfilesCallable();
 
 private:
@@ -5,8 +5,10 @@
 #include <userver/logging/log.hpp>
 #include <utility>
 #include <string_view>
+#include <vector>
 
 // userver
+#include <userver/engine/task/task_with_result.hpp>
 #include <userver/kafka/producer.hpp>
 #include <userver/kafka/exceptions.hpp>
 #include <userver/logging/logger.hpp>
@@ -18,6 +20,26 @@
 
 namespace director_service {
 
+namespace {
+
+std::string SerializeRequest(
+  const profile::Profile& profile,
+  const rules::RuleConfig& config,
+  const transaction::Transaction& transaction,
+  size_t number
+) {
+    auto request = rules::RuleRequest{};
+    request.set_profile_uuid(profile.name());
+    request.set_profile_name(profile.uuid());
+    request.mutable_rule()->CopyFrom(config);
+    request.mutable_transaction()->CopyFrom(transaction);
+    request.set_number(number);
+    request.set_total_rule_count(std::size(profile.rules()));
+    return request.SerializeAsString();
+}
+
+} // namespace
+
 
 std::pair<size_t, RuleRequestProducer::SendStatus> RuleRequestProducer::operator()(
   const std::string& topic,
@@ -27,23 +49,16 @@ std::pair<size_t, RuleRequestProducer::SendStatus> RuleRequestProducer::operator
 ) const {
     size_t sended_count = 0;
 
+    // keyed by sender so that all requests of an account share one partition
+    // and therefore one rules_service replica that owns its in-memory state
     auto send_request = [
-        &, key = transaction.transaction_id() + profile.uuid(),
-        total_rule_count = std::size(profile.rules())](
+        &, key = transaction.sender_account()](
       transaction::Transaction& transaction,
       rules::RuleConfig& config,
       size_t number
     ) {
         try {
-            auto request = rules::RuleRequest{};
-            request.set_profile_uuid(profile.name());
-            request.set_profile_name(profile.uuid());
-            request.mutable_rule()->CopyFrom(config);
-            request.mutable_transaction()->CopyFrom(transaction);
-            request.set_number(number);
-            request.set_total_rule_count(total_rule_count);
-
-            auto message = request.SerializeAsString();
+            auto message = SerializeRequest(profile, config, transaction, number);
 
             if (message.size() == 0) {
                 return SendStatus::kErrorSerializationNonRetryable;
@@ -69,5 +84,53 @@ std::pair<size_t, RuleRequestProducer::SendStatus> RuleRequestProducer::operator
     return {sended_count, SendStatus::kSuccess};
 }
 
+std::pair<size_t, RuleRequestProducer::SendStatus> RuleRequestProducer::operator()(
+  const std::string& topic,
+  const userver::kafka::Producer& producer,
+  const std::vector<const profile::Profile*>& profiles,
+  const std::vector<transaction::Transaction>& transactions
+) const {
+    auto status = SendStatus::kSuccess;
+    auto fail = [&status](SendStatus failure) {
+        if (status == SendStatus::kSuccess) {
+            status = failure;
+        }
+    };
+
+    size_t rule_count = 0;
+    for (const auto* profile : profiles) {
+        rule_count += std::size(profile->rules());
+    }
+
+    std::vector<userver::engine::TaskWithResult<void>> deliveries;
+    deliveries.reserve(std::size(transactions) * rule_count);
+    for (const auto& transaction : transactions) {
+        for (const auto* profile : profiles) {
+            size_t number = 0;
+            for (const auto& config : profile->rules()) {
+                auto message = SerializeRequest(*profile, config, transaction, number++);
+                if (message.empty()) {
+                    fail(SendStatus::kErrorSerializationNonRetryable);
+                    continue;
+                }
+                deliveries.push_back(producer.SendAsync(topic, transaction.sender_account(), std::move(message)));
+            }
+        }
+    }
+
+    size_t delivered_count = 0;
+    for (auto& delivery : deliveries) {
+        try {
+            delivery.Get();
+            ++delivered_count;
+        } catch (const userver::kafka::SendException& ex) {
+            LOG_ERROR() << "kafka production fail: " << ex.what();
+            fail(ex.IsRetryable() ? SendStatus::kErrorRetryable : SendStatus::kErrorNonRetryable);
+        }
+    }
+
+    return {delivered_count, status};
+}
+
 
 } // namespace director_service
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 // stdcpp
 #include <utility>
+#include <vector>
 
 // userver
 #include <userver/kafka/producer.hpp>
@@ -34,6 +35,19 @@ public:
         profile::Profile& profile,
         transaction::Transaction& transaction
     ) const;
+
+    // Fans a batch out: the requests of every rule of every profile for every
+    // transaction are queued on the producer before the first delivery is
+    // awaited. A transaction's requests are queued back to back, so they stay
+    // close in the partition and rules_service sees them in one consumer
+    // batch. Returns the number of delivered requests and the first failure,
+    // if any.
+    std::pair<size_t, SendStatus> operator()(
+        const std::string& topic,
+        const userver::kafka::Producer& producer,
+        const std::vector<const profile::Profile*>& profiles,
+        const std::vector<transaction::Transaction>& transactions
+    ) const;
 };
 
 
@@ -7,12 +7,16 @@
 // userver
 #include <userver/logging/log.hpp> 
 
+// grpc
+#include <grpcpp/support/status.h>
+
 // models
 #include <rules/profile_service.usrv.pb.hpp>
 #include <google/protobuf/empty.pb.h>
 
 // self
 #include <director.hpp>
+#include <rule_compiler.hpp>
 
 namespace director_service {
 
@@ -27,12 +31,26 @@ ProfileReceiver::ProcessProfileStreamResult ProfileReceiver::ProcessProfileStrea
     LOG_INFO() << "Profile receiver stream connection open";
 
     Director::ProfileContainer profiles;
+    std::string errors;
     while (reader.Read(request)) {
         LOG_INFO() << fmt::format("receive new profile, name: {} uuid: {}", request.name(), request.uuid());
+        try {
+            kRuleCompiler(request);
+        } catch (const RuleCompileError& ex) {
+            errors += fmt::format("{}profile {} ({}): {}", errors.empty() ? "" : "\n", request.name(), request.uuid(), ex.what());
+            continue;
+        }
         profiles.insert(std::move(request));
     }
     LOG_INFO() << "Profile receiver stream connection closed";
 
+    // the upload replaces every profile, so one invalid rule rejects all of
+    // them and the director keeps serving the previous set
+    if (!errors.empty()) {
+        LOG_WARNING() << "Profile update rejected: " << errors;
+        return grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, errors};
+    }
+
     _update_callable(std::move(profiles));
 
     google::protobuf::Empty response;
@@ -0,0 +1,498 @@
+#include "rule_compiler.hpp"
+
+// stdcpp
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+// userver
+#include <userver/logging/log.hpp>
+
+// another
+#include <fmt/format.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+// self
+#include <rules/profile.pb.h>
+#include <rules/rule_config.pb.h>
+
+
+namespace director_service {
+
+namespace {
+
+enum class ValueType {
+    kString,
+    kNumber,
+    kBool,
+};
+
+std::string_view ToString(ValueType type) {
+    switch (type) {
+        case ValueType::kString: return "string";
+        case ValueType::kNumber: return "number";
+        case ValueType::kBool: return "bool";
+    }
+    return "unknown";
+}
+
+// Enum fields reach the analyzers as their int value.
+std::optional<ValueType> FieldValueType(rules::FieldReference::FieldType field) {
+    switch (field) {
+        case rules::FieldReference::TRANSACTION_ID:
+        case rules::FieldReference::SENDER_ACCOUNT:
+        case rules::FieldReference::TIMESTAMP:
+        case rules::FieldReference::RECEIVER_ACCOUNT:
+        case rules::FieldReference::MERCHANT_CATEGORY:
+        case rules::FieldReference::LOCATION:
+        case rules::FieldReference::IP_ADDRESS:
+        case rules::FieldReference::DEVICE_HASH:
+            return ValueType::kString;
+        case rules::FieldReference::AMOUNT:
+        case rules::FieldReference::TRANSACTION_TYPE:
+        case rules::FieldReference::DEVICE_USED:
+        case rules::FieldReference::PAYMENT_CHANNEL:
+            return ValueType::kNumber;
+        default:
+            return std::nullopt;
+    }
+}
+
+// Fields the transactions table has a column for, i.e. what SQL aggregates
+// can read.
+bool IsAggregatableField(rules::FieldReference::FieldType field) {
+    return field != rules::FieldReference::TRANSACTION_ID &&
+           field != rules::FieldReference::TIMESTAMP &&
+           FieldValueType(field).has_value();
+}
+
+// Keys the keyed window store and the SQL aggregates can group by.
+bool IsGroupByField(rules::FieldReference::FieldType field) {
+    switch (field) {
+        case rules::FieldReference::SENDER_ACCOUNT:
+        case rules::FieldReference::RECEIVER_ACCOUNT:
+        case rules::FieldReference::MERCHANT_CATEGORY:
+        case rules::FieldReference::LOCATION:
+        case rules::FieldReference::IP_ADDRESS:
+        case rules::FieldReference::DEVICE_HASH:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IsEquality(rules::ComparisonOperation::Operator op) {
+    return op == rules::ComparisonOperation::EQUAL || op == rules::ComparisonOperation::NOT_EQUAL;
+}
+
+template <typename T>
+bool Compare(const T& left, const T& right, rules::ComparisonOperation::Operator op) {
+    switch (op) {
+        case rules::ComparisonOperation::EQUAL: return left == right;
+        case rules::ComparisonOperation::NOT_EQUAL: return left != right;
+        case rules::ComparisonOperation::GREATER_THAN: return left > right;
+        case rules::ComparisonOperation::GREATER_THAN_OR_EQUAL: return left >= right;
+        case rules::ComparisonOperation::LESS_THAN: return left < right;
+        default: return left <= right;
+    }
+}
+
+float NumericLiteral(const rules::LiteralValue& literal) {
+    return literal.value_case() == rules::LiteralValue::kFloatValue
+        ? literal.float_value()
+        : static_cast<float>(literal.int_value());
+}
+
+// Same result ComparisonEvaluator gives at runtime; the types are checked.
+bool CompareLiterals(
+  const rules::LiteralValue& left,
+  const rules::LiteralValue& right,
+  rules::ComparisonOperation::Operator op
+) {
+    switch (left.value_case()) {
+        case rules::LiteralValue::kStringValue:
+            return Compare(left.string_value(), right.string_value(), op);
+        case rules::LiteralValue::kBoolValue:
+            return Compare(left.bool_value(), right.bool_value(), op);
+        default:
+            return Compare(NumericLiteral(left), NumericLiteral(right), op);
+    }
+}
+
+bool IsBoolLiteral(const rules::Expression& expr) {
+    return expr.expr_case() == rules::Expression::kLiteral &&
+           expr.literal().value_case() == rules::LiteralValue::kBoolValue;
+}
+
+void SetBoolLiteral(rules::Expression& expr, bool value) {
+    expr.Clear();
+    expr.mutable_literal()->set_bool_value(value);
+}
+
+// Byte-stable form of an expression, the identity for duplicate operands.
+std::string CanonicalForm(const rules::Expression& expr) {
+    std::string bytes;
+    google::protobuf::io::StringOutputStream stream{&bytes};
+    google::protobuf::io::CodedOutputStream output{&stream};
+    output.SetSerializationDeterministic(true);
+    expr.SerializeToCodedStream(&output);
+    output.Trim();
+    return bytes;
+}
+
+size_t CountNodes(const rules::Expression& expr) {
+    switch (expr.expr_case()) {
+        case rules::Expression::kAggregate:
+            return 1 + CountNodes(expr.aggregate().operand());
+        case rules::Expression::kComparison:
+            return 1 + CountNodes(expr.comparison().left()) + CountNodes(expr.comparison().right());
+        case rules::Expression::kLogical: {
+            size_t count = 1;
+            for (const auto& operand : expr.logical().operands()) {
+                count += CountNodes(operand);
+            }
+            return count;
+        }
+        case rules::Expression::EXPR_NOT_SET:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+
+class ExpressionCompiler {
+public:
+    explicit ExpressionCompiler(bool allow_aggregates)
+        : _allow_aggregates(allow_aggregates) {  }
+
+    // Boolean expression of a composite or pattern rule, folded in place.
+    void CompileCondition(rules::Expression& expr, const std::string& path) const {
+        switch (expr.expr_case()) {
+            case rules::Expression::kComparison:
+                CheckComparison(expr.comparison(), path + ".comparison");
+                if (expr.comparison().left().expr_case() == rules::Expression::kLiteral &&
+                    expr.comparison().right().expr_case() == rules::Expression::kLiteral) {
+                    const auto& comparison = expr.comparison();
+                    SetBoolLiteral(expr, CompareLiterals(
+                        comparison.left().literal(), comparison.right().literal(), comparison.operator_()));
+                }
+                return;
+            case rules::Expression::kLogical:
+                CompileLogical(expr, path + ".logical");
+                return;
+            case rules::Expression::kLiteral:
+                if (IsBoolLiteral(expr)) {
+                    return;
+                }
+                [[fallthrough]];
+            default:
+                throw RuleCompileError(fmt::format("{}: expression is not boolean", path));
+        }
+    }
+
+    void CheckComparison(const rules::ComparisonOperation& comparison, const std::string& path) const {
+        if (!rules::ComparisonOperation::Operator_IsValid(comparison.operator_())) {
+            throw RuleCompileError(fmt::format("{}: unknown operator {}", path, comparison.operator_()));
+        }
+        const auto left = CheckValue(comparison.left(), path + ".left");
+        const auto right = CheckValue(comparison.right(), path + ".right");
+        if (left != right) {
+            throw RuleCompileError(fmt::format(
+                "{}: cannot compare {} with {}", path, ToString(left), ToString(right)));
+        }
+        if (left != ValueType::kNumber && !IsEquality(comparison.operator_())) {
+            throw RuleCompileError(fmt::format(
+                "{}: {} values support only EQUAL and NOT_EQUAL", path, ToString(left)));
+        }
+    }
+
+private:
+    void CompileLogical(rules::Expression& expr, const std::string& path) const {
+        auto& logical = *expr.mutable_logical();
+        const auto op = logical.operator_();
+        if (!rules::LogicalOperation::Operator_IsValid(op)) {
+            throw RuleCompileError(fmt::format("{}: unknown operator {}", path, op));
+        }
+
+        if (op == rules::LogicalOperation::NOT) {
+            if (logical.operands_size() != 1) {
+                throw RuleCompileError(fmt::format(
+                    "{}: NOT requires exactly one operand, got {}", path, logical.operands_size()));
+            }
+            auto& operand = *logical.mutable_operands(0);
+            CompileCondition(operand, path + ".operands[0]");
+            if (IsBoolLiteral(operand)) {
+                SetBoolLiteral(expr, !operand.literal().bool_value());
+            } else if (operand.expr_case() == rules::Expression::kLogical &&
+                       operand.logical().operator_() == rules::LogicalOperation::NOT) {
+                rules::Expression inner = std::move(*operand.mutable_logical()->mutable_operands(0));
+                expr = std::move(inner);
+            }
+            return;
+        }
+
+        if (logical.operands_size() == 0) {
+            throw RuleCompileError(fmt::format(
+                "{}: {} without operands", path, rules::LogicalOperation::Operator_Name(op)));
+        }
+
+        // false absorbs AND and true absorbs OR; the other constant is neutral.
+        const bool absorbing = op == rules::LogicalOperation::OR;
+        google::protobuf::RepeatedPtrField<rules::Expression> operands;
+        std::unordered_set<std::string> seen;
+        auto append = [&](rules::Expression& operand) {
+            if (seen.insert(CanonicalForm(operand)).second) {
+                *operands.Add() = std::move(operand);
+            }
+        };
+
+        for (int i = 0; i < logical.operands_size(); ++i) {
+            auto& operand = *logical.mutable_operands(i);
+            CompileCondition(operand, fmt::format("{}.operands[{}]", path, i));
+            if (IsBoolLiteral(operand)) {
+                if (operand.literal().bool_value() == absorbing) {
+                    SetBoolLiteral(expr, absorbing);
+                    return;
+                }
+                continue;
+            }
+            // Operands are compiled already, so a nested node of the same
+            // operator is flat and free of duplicates of its own.
+            if (operand.expr_case() == rules::Expression::kLogical && operand.logical().operator_() == op) {
+                for (auto& nested : *operand.mutable_logical()->mutable_operands()) {
+                    append(nested);
+                }
+                continue;
+            }
+            append(operand);
+        }
+
+        if (operands.empty()) {
+            SetBoolLiteral(expr, !absorbing);
+        } else if (operands.size() == 1) {
+            rules::Expression single = std::move(operands[0]);
+            expr = std::move(single);
+        } else {
+            logical.mutable_operands()->Swap(&operands);
+        }
+    }
+
+    ValueType CheckValue(const rules::Expression& expr, const std::string& path) const {
+        switch (expr.expr_case()) {
+            case rules::Expression::kField:
+                return CheckField(expr.field(), path + ".field");
+            case rules::Expression::kLiteral:
+                switch (expr.literal().value_case()) {
+                    case rules::LiteralValue::kStringValue: return ValueType::kString;
+                    case rules::LiteralValue::kFloatValue:
+                    case rules::LiteralValue::kIntValue: return ValueType::kNumber;
+                    case rules::LiteralValue::kBoolValue: return ValueType::kBool;
+                    default: throw RuleCompileError(fmt::format("{}.literal: literal has no value", path));
+                }
+            case rules::Expression::kAggregate:
+                if (!_allow_aggregates) {
+                    throw RuleCompileError(fmt::format("{}: aggregates are supported in pattern rules only", path));
+                }
+                CheckAggregate(expr.aggregate(), path + ".aggregate");
+                return ValueType::kNumber;
+            case rules::Expression::EXPR_NOT_SET:
+                throw RuleCompileError(fmt::format("{}: operand is missing", path));
+            default:
+                throw RuleCompileError(fmt::format("{}: expected a field, literal or aggregate", path));
+        }
+    }
+
+    static ValueType CheckField(const rules::FieldReference& field, const std::string& path) {
+        const auto type = FieldValueType(field.field());
+        if (!type) {
+            throw RuleCompileError(fmt::format("{}: unknown field {}", path, field.field()));
+        }
+        return *type;
+    }
+
+    static void CheckAggregate(const rules::AggregateFunction& aggregate, const std::string& path) {
+        const auto function = aggregate.function();
+        if (!rules::AggregateFunction::AggregateType_IsValid(function)) {
+            throw RuleCompileError(fmt::format("{}: unknown function {}", path, function));
+        }
+        const auto& name = rules::AggregateFunction::AggregateType_Name(function);
+
+        std::optional<rules::FieldReference::FieldType> operand;
+        switch (aggregate.operand().expr_case()) {
+            case rules::Expression::kField:
+                CheckField(aggregate.operand().field(), path + ".operand.field");
+                operand = aggregate.operand().field().field();
+                break;
+            case rules::Expression::EXPR_NOT_SET:
+                break;
+            default:
+                throw RuleCompileError(fmt::format("{}: the operand of {} must be a field", path, name));
+        }
+
+        if (aggregate.has_group_by() && !IsGroupByField(aggregate.group_by().field())) {
+            throw RuleCompileError(fmt::format(
+                "{}: cannot group by {}", path,
+                rules::FieldReference::FieldType_Name(aggregate.group_by().field())));
+        }
+
+        switch (function) {
+            case rules::AggregateFunction::COUNT:
+                if (operand && !IsAggregatableField(*operand)) {
+                    throw RuleCompileError(fmt::format(
+                        "{}: {} is not supported in aggregates", path,
+                        rules::FieldReference::FieldType_Name(*operand)));
+                }
+                return;
+            case rules::AggregateFunction::COUNT_DISTINCT:
+                if (!operand || !IsAggregatableField(*operand)) {
+                    throw RuleCompileError(fmt::format("{}: COUNT_DISTINCT requires a transaction field", path));
+                }
+                return;
+            case rules::AggregateFunction::PERCENTILE:
+                if (aggregate.percentile() < 0 || aggregate.percentile() > 100) {
+                    throw RuleCompileError(fmt::format(
+                        "{}: percentile {} is out of 0..100", path, aggregate.percentile()));
+                }
+                [[fallthrough]];
+            case rules::AggregateFunction::SUM:
+            case rules::AggregateFunction::AVG:
+            case rules::AggregateFunction::MIN:
+            case rules::AggregateFunction::MAX:
+            case rules::AggregateFunction::MEDIAN:
+                if (operand != rules::FieldReference::AMOUNT) {
+                    throw RuleCompileError(fmt::format("{}: {} applies to AMOUNT only", path, name));
+                }
+                return;
+            default:
+                break;
+        }
+
+        // DECAYED_*: the half-life set is the service's decayed_half_lives,
+        // which only rules_service knows.
+        if (aggregate.half_life() <= 0) {
+            throw RuleCompileError(fmt::format("{}: {} requires a positive half_life", path, name));
+        }
+        if (aggregate.has_group_by() && aggregate.group_by().field() != rules::FieldReference::SENDER_ACCOUNT) {
+            throw RuleCompileError(fmt::format("{}: {} is computed per sender and cannot be grouped", path, name));
+        }
+        if ((function == rules::AggregateFunction::DECAYED_MEAN ||
+             function == rules::AggregateFunction::DECAYED_STD) &&
+            operand != rules::FieldReference::AMOUNT) {
+            throw RuleCompileError(fmt::format("{}: {} applies to AMOUNT only", path, name));
+        }
+        if (function == rules::AggregateFunction::DECAYED_FREQUENCY && operand != rules::FieldReference::LOCATION) {
+            throw RuleCompileError(fmt::format("{}: {} applies to LOCATION only", path, name));
+        }
+    }
+
+    const bool _allow_aggregates;
+};
+
+
+void CompileRule(rules::RuleConfig& rule) {
+    if (rule.uuid().empty()) {
+        throw RuleCompileError("rule has no uuid");
+    }
+    if (!rules::RuleConfig::RuleType_IsValid(rule.rule_type())) {
+        throw RuleCompileError(fmt::format("unknown rule type {}", rule.rule_type()));
+    }
+
+    const auto rule_case = rule.rule_case();
+    const auto type = rule.rule_type();
+    const bool matches =
+        (type == rules::RuleConfig::ML && rule_case == rules::RuleConfig::kMlRule) ||
+        (type == rules::RuleConfig::COMPOSITE && rule_case == rules::RuleConfig::kCompositeRule) ||
+        (type == rules::RuleConfig::THRESHOLD && rule_case == rules::RuleConfig::kThresholdRule) ||
+        (type == rules::RuleConfig::PATTERN && rule_case == rules::RuleConfig::kPatternRule);
+    if (!matches) {
+        throw RuleCompileError(fmt::format(
+            "rule type {} does not match its body", rules::RuleConfig::RuleType_Name(type)));
+    }
+
+    rules::Expression* expression = nullptr;
+    std::string path;
+    switch (rule_case) {
+        case rules::RuleConfig::kMlRule:
+            if (rule.ml_rule().model_uuid().empty()) {
+                throw RuleCompileError("ml_rule: model_uuid is empty");
+            }
+            return;
+
+        case rules::RuleConfig::kThresholdRule: {
+            // ThresholdRuleAnalyzer evaluates a single comparison, so it is
+            // checked but never folded into a literal.
+            const auto& expr = rule.threshold_rule().expression();
+            if (expr.expr_case() != rules::Expression::kComparison) {
+                throw RuleCompileError("threshold_rule.expression: threshold rules support only a comparison");
+            }
+            ExpressionCompiler{false}.CheckComparison(expr.comparison(), "threshold_rule.expression.comparison");
+            return;
+        }
+
+        case rules::RuleConfig::kCompositeRule:
+            expression = rule.mutable_composite_rule()->mutable_expression();
+            path = "composite_rule.expression";
+            break;
+
+        case rules::RuleConfig::kPatternRule: {
+            const auto& pattern = rule.pattern_rule();
+            if (pattern.max_delta_time() < 0 || pattern.max_count() < 0) {
+                throw RuleCompileError("pattern_rule: max_delta_time and max_count must not be negative");
+            }
+            if (pattern.distinct_precision() != 0 &&
+                (pattern.distinct_precision() < 4 || pattern.distinct_precision() > 14)) {
+                throw RuleCompileError(fmt::format(
+                    "pattern_rule: distinct_precision {} is not 0 or 4..14", pattern.distinct_precision()));
+            }
+            expression = rule.mutable_pattern_rule()->mutable_expression();
+            path = "pattern_rule.expression";
+            break;
+        }
+
+        default:
+            throw RuleCompileError("rule has no body");
+    }
+
+    const size_t nodes_before = CountNodes(*expression);
+    ExpressionCompiler{rule_case == rules::RuleConfig::kPatternRule}.CompileCondition(*expression, path);
+    const size_t nodes_after = CountNodes(*expression);
+    if (nodes_after != nodes_before) {
+        LOG_INFO() << fmt::format("Rule compiled: uuid: {}, expression nodes: {} -> {}",
+            rule.uuid(), nodes_before, nodes_after);
+    }
+    if (IsBoolLiteral(*expression)) {
+        LOG_WARNING() << fmt::format("Rule is constant: uuid: {}, value: {}",
+            rule.uuid(), expression->literal().bool_value());
+    }
+}
+
+} // namespace
+
+
+void RuleCompiler::operator()(rules::RuleConfig& rule) const {
+    CompileRule(rule);
+}
+
+void RuleCompiler::operator()(profile::Profile& profile) const {
+    std::string errors;
+    for (auto& rule : *profile.mutable_rules()) {
+        try {
+            CompileRule(rule);
+        } catch (const RuleCompileError& ex) {
+            if (!errors.empty()) {
+                errors += "; ";
+            }
+            errors += fmt::format("rule {} ({}): {}", rule.name(), rule.uuid(), ex.what());
+        }
+    }
+    if (!errors.empty()) {
+        throw RuleCompileError(errors);
+    }
+}
+
+
+} // namespace director_service
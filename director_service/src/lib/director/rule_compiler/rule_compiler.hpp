@@ -0,0 +1,42 @@
+#pragma once
+
+// stdcpp
+#include <stdexcept>
+
+// self
+#include <rules/profile.pb.h>
+#include <rules/rule_config.pb.h>
+
+
+namespace director_service {
+
+
+// A rule rules_service could not evaluate; what() names the rule and the
+// offending expression node.
+class RuleCompileError : public std::invalid_argument {
+public:
+    using std::invalid_argument::invalid_argument;
+};
+
+
+// Checks rules at profile upload time and rewrites their expressions into
+// the form rules_service evaluates cheapest: constant subtrees folded,
+// nested AND/OR flattened, duplicate operands dropped. Types follow the rule
+// analyzers of rules_service: numbers compare as float, strings and bools
+// support only EQUAL and NOT_EQUAL.
+class RuleCompiler {
+public:
+    constexpr RuleCompiler() = default;
+
+public:
+    // Compiles every rule of the profile in place. Throws RuleCompileError
+    // listing all invalid rules; the profile is left partially compiled then.
+    void operator()(profile::Profile& profile) const;
+
+    void operator()(rules::RuleConfig& rule) const;
+};
+
+
+inline constexpr RuleCompiler kRuleCompiler = {};
+
+} // namespace director_service
@@ -1,5 +1,9 @@
 #include "transaction_receiver.hpp"
 
+// stdcpp
+#include <algorithm>
+#include <vector>
+
 // userver
 #include <userver/logging/log.hpp> 
 #include <userver/components/component_context.hpp>
@@ -20,9 +24,14 @@ namespace director_service {
 
 TransactionReceiver::TransactionReceiver(
     std::string prefix,
-    DirectorComponent::ProcessTransactionCallableType process_callable
+    DirectorComponent::ProcessTransactionCallableType process_callable,
+    DirectorComponent::ProcessTransactionsCallableType process_batch_callable,
+    size_t max_batch_size
 ) 
-    : _prefix(prefix), _process_callable(process_callable) {  };
+    : _prefix(prefix),
+    _process_callable(process_callable),
+    _process_batch_callable(std::move(process_batch_callable)),
+    _max_batch_size(std::max<size_t>(max_batch_size, 1)) {  };
 
 TransactionReceiver::ProcessTransactionResult TransactionReceiver::ProcessTransaction(
   CallContext&, 
@@ -33,6 +42,63 @@ TransactionReceiver::ProcessTransactionResult TransactionReceiver::ProcessTransa
     return response;
 }
 
+TransactionReceiver::ProcessTransactionsResult TransactionReceiver::ProcessTransactions(
+  CallContext&,
+  transaction::TransactionBatch&& request) {
+    LOG_INFO() << fmt::format("receive transaction batch, size: {}", request.transactions_size());
+
+    std::vector<transaction::Transaction> batch;
+    batch.reserve(std::min<size_t>(request.transactions_size(), _max_batch_size));
+    for (auto& transaction : *request.mutable_transactions()) {
+        batch.push_back(std::move(transaction));
+        if (batch.size() >= _max_batch_size) {
+            FlushBatch(batch);
+        }
+    }
+    FlushBatch(batch);
+
+    transaction::TransactionBatchResult response;
+    response.set_accepted(request.transactions_size());
+    return response;
+}
+
+TransactionReceiver::ProcessTransactionStreamResult TransactionReceiver::ProcessTransactionStream(
+  CallContext&,
+  ProcessTransactionStreamReader& reader) {
+    LOG_INFO() << "Transaction receiver stream connection open";
+
+    // flushed every _max_batch_size transactions, so a long-lived stream is
+    // processed while it is open rather than when it closes
+    std::vector<transaction::Transaction> batch;
+    batch.reserve(_max_batch_size);
+    transaction::Transaction request;
+    uint64_t accepted = 0;
+    while (reader.Read(request)) {
+        batch.push_back(std::move(request));
+        ++accepted;
+        if (batch.size() >= _max_batch_size) {
+            FlushBatch(batch);
+        }
+    }
+    FlushBatch(batch);
+
+    LOG_INFO() << fmt::format("Transaction receiver stream connection closed, accepted: {}", accepted);
+
+    transaction::TransactionBatchResult response;
+    response.set_accepted(accepted);
+    return response;
+}
+
+void TransactionReceiver::FlushBatch(std::vector<transaction::Transaction>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::vector<transaction::Transaction> full;
+    full.reserve(_max_batch_size);
+    full.swap(batch);
+    _process_batch_callable(std::move(full));
+}
+
 TransactionReceiver::~TransactionReceiver() {  }
 
 
@@ -43,7 +109,9 @@ TransactionReceiverComponent::TransactionReceiverComponent(
   : userver::ugrpc::server::ServiceComponentBase(config, context),
   _service(
         config["transaction-prefix"].As<std::string>(),
-        context.FindComponent<DirectorComponent>("director-producer").GetProcessTransactionCallable()
+        context.FindComponent<DirectorComponent>("director-producer").GetProcessTransactionCallable(),
+        context.FindComponent<DirectorComponent>("director-producer").GetProcessTransactionsCallable(),
+        config["max-batch-size"].As<size_t>(512)
   ) {
     RegisterService(_service);
 }
@@ -57,6 +125,10 @@ properties:
     transaction-prefix:
         type: string
         description: transaction prefix
+    max-batch-size:
+        type: integer
+        description: transactions handed to the director as one batch by ProcessTransactions and ProcessTransactionStream
+        minimum: 1
 )");
 }
 
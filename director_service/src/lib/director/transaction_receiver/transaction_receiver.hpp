@@ -4,6 +4,7 @@
 #include "director.hpp"
 #include <string>
 #include <string_view>
+#include <vector>
 
 // userver
 #include <userver/ugrpc/server/service_component_base.hpp>
@@ -26,16 +27,31 @@ class TransactionReceiver final : public transaction::TransactionServiceBase {
 public:
     explicit TransactionReceiver(
         std::string prefix,
-        DirectorComponent::ProcessTransactionCallableType process_callable
+        DirectorComponent::ProcessTransactionCallableType process_callable,
+        DirectorComponent::ProcessTransactionsCallableType process_batch_callable,
+        size_t max_batch_size
     );
 
     ProcessTransactionResult ProcessTransaction(CallContext&, transaction::Transaction&& request) override;
 
+    ProcessTransactionsResult ProcessTransactions(CallContext&, transaction::TransactionBatch&& request) override;
+
+    ProcessTransactionStreamResult ProcessTransactionStream(
+        CallContext&,
+        ProcessTransactionStreamReader& reader
+    ) override;
+
     ~TransactionReceiver() override;
 
+private:
+    // Hands a full batch to the director and starts a new one.
+    void FlushBatch(std::vector<transaction::Transaction>& batch);
+
 private:
     const std::string _prefix;
     DirectorComponent::ProcessTransactionCallableType _process_callable;
+    DirectorComponent::ProcessTransactionsCallableType _process_batch_callable;
+    const size_t _max_batch_size;
 };
 
 
@@ -6,6 +6,7 @@
 #include <userver/testsuite/testsuite_support.hpp>
 #include <userver/kafka/consumer_component.hpp>
 #include <userver/kafka/producer_component.hpp>
+#include <userver/server/handlers/server_monitor.hpp>
 #include <userver/utils/daemon_run.hpp>
 
 #include "rule_processor/rule_processor.hpp"
@@ -18,6 +19,7 @@ int main(int argc, char* argv[]) {
         .Append<userver::components::Secdist>()
         .Append<userver::components::DefaultSecdistProvider>()
         .Append<userver::components::TestsuiteSupport>()
+        .Append<userver::server::handlers::ServerMonitor>()
         .Append<userver::components::Postgres>("postgres-db-1")
         .Append<userver::kafka::ConsumerComponent>()
         .Append<userver::kafka::ProducerComponent>()
@@ -0,0 +1,146 @@
+#include "account_state.hpp"
+
+#include <algorithm>
+
+namespace fraud_detection {
+
+std::string_view GetDistinctFieldValue(const transaction::Transaction& tx, DistinctField field) {
+    switch (field) {
+        case DistinctField::kReceiverAccount: return tx.receiver_account();
+        case DistinctField::kMerchantCategory: return tx.merchant_category();
+        case DistinctField::kLocation: return tx.location();
+        case DistinctField::kIpAddress: return tx.ip_address();
+        case DistinctField::kDeviceHash: return tx.device_hash();
+    }
+    return {};
+}
+
+void AccountState::Apply(const transaction::Transaction& tx, int64_t timestamp) {
+    if (transaction_count == 0 || timestamp < first_timestamp) {
+        first_timestamp = timestamp;
+    }
+    if (transaction_count == 0) {
+        sketch_since = timestamp;
+    }
+    recent_transactions.push_back(HyperLogLog::Hash(tx.transaction_id()));
+    if (recent_transactions.size() > kRecentTransactions) {
+        recent_transactions.pop_front();
+    }
+    last_timestamp = std::max(last_timestamp, timestamp);
+    ++transaction_count;
+    amount_sum += tx.amount();
+    AddToSketches(tx, timestamp);
+    for (auto& stats : decayed) {
+        stats.Add(timestamp, tx.amount(), tx.location());
+    }
+}
+
+bool AccountState::IsApplied(const transaction::Transaction& tx) const {
+    const auto hash = HyperLogLog::Hash(tx.transaction_id());
+    return std::find(recent_transactions.begin(), recent_transactions.end(), hash) !=
+           recent_transactions.end();
+}
+
+void AccountState::ConfigureDecayed(const std::vector<int64_t>& half_lives) {
+    std::vector<DecayedStats> configured;
+    configured.reserve(half_lives.size());
+    for (auto half_life : half_lives) {
+        auto it = std::find_if(decayed.begin(), decayed.end(), [half_life](const DecayedStats& stats) {
+            return stats.HalfLife() == half_life;
+        });
+        configured.push_back(it != decayed.end() ? *it : DecayedStats{half_life});
+    }
+    decayed = std::move(configured);
+}
+
+bool AccountState::CoversSketches(int64_t since) const {
+    return since >= sketch_since && since >= last_timestamp - SketchBuckets::kRetention;
+}
+
+void AccountState::BackfillSketches(
+    const std::vector<transaction::Transaction>& history,
+    int64_t since) {
+    for (const auto& tx : history) {
+        int64_t timestamp = 0;
+        try {
+            timestamp = std::stoll(tx.timestamp());
+        } catch (const std::exception&) {
+            continue;
+        }
+        // The digests count duplicates, so skip what Apply already added.
+        if (timestamp < sketch_since) {
+            AddToSketches(tx, timestamp);
+        }
+    }
+    sketch_since = std::min(sketch_since, since);
+}
+
+void AccountState::AddToSketches(const transaction::Transaction& tx, int64_t timestamp) {
+    for (size_t i = 0; i < kDistinctFieldCount; ++i) {
+        const auto value = GetDistinctFieldValue(tx, static_cast<DistinctField>(i));
+        if (!value.empty()) {
+            distinct[i].Add(timestamp, HyperLogLog::Hash(value));
+        }
+    }
+    amounts.Add(timestamp, tx.amount());
+}
+
+void AccountState::Serialize(std::string& out) const {
+    BinaryWriter writer(out);
+    writer.Write(first_timestamp);
+    writer.Write(last_timestamp);
+    writer.Write(transaction_count);
+    writer.Write(amount_sum);
+    writer.Write(sketch_since);
+    writer.Write(static_cast<uint32_t>(recent_transactions.size()));
+    for (auto hash : recent_transactions) {
+        writer.Write(hash);
+    }
+    for (const auto& sketch : distinct) {
+        sketch.Serialize(writer);
+    }
+    amounts.Serialize(writer);
+    writer.Write(static_cast<uint32_t>(decayed.size()));
+    for (const auto& stats : decayed) {
+        stats.Serialize(writer);
+    }
+}
+
+bool AccountState::Deserialize(std::string_view in, AccountState& state) {
+    BinaryReader reader(in);
+    if (!(reader.Read(state.first_timestamp) &&
+          reader.Read(state.last_timestamp) &&
+          reader.Read(state.transaction_count) &&
+          reader.Read(state.amount_sum) &&
+          reader.Read(state.sketch_since))) {
+        return false;
+    }
+    uint32_t id_count = 0;
+    if (!reader.Read(id_count)) {
+        return false;
+    }
+    state.recent_transactions.resize(id_count);
+    for (auto& hash : state.recent_transactions) {
+        if (!reader.Read(hash)) {
+            return false;
+        }
+    }
+    for (auto& sketch : state.distinct) {
+        if (!BucketedSketch<HyperLogLog>::Deserialize(reader, sketch)) {
+            return false;
+        }
+    }
+    uint32_t decayed_count = 0;
+    if (!BucketedSketch<TDigest>::Deserialize(reader, state.amounts) || !reader.Read(decayed_count)) {
+        return false;
+    }
+    state.decayed.resize(decayed_count);
+    for (auto& stats : state.decayed) {
+        if (!DecayedStats::Deserialize(reader, stats)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace fraud_detection
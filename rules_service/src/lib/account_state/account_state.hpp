@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <transaction/transaction.pb.h>
+
+#include "binary_io.hpp"
+#include "decayed_stats.hpp"
+#include "hyperloglog.hpp"
+#include "t_digest.hpp"
+
+namespace fraud_detection {
+
+// Transaction fields with per-account distinct-value sketches.
+enum class DistinctField : uint8_t {
+    kReceiverAccount = 0,
+    kMerchantCategory,
+    kLocation,
+    kIpAddress,
+    kDeviceHash,
+};
+
+inline constexpr size_t kDistinctFieldCount = 5;
+
+std::string_view GetDistinctFieldValue(const transaction::Transaction& tx, DistinctField field);
+
+// Bucket layout shared by the time-bucketed sketches: minute buckets for the
+// last day and hour buckets up to kRetention.
+struct SketchBuckets {
+    static constexpr int64_t kMinuteBucket = 60;
+    static constexpr int64_t kHourBucket = 3600;
+    static constexpr int64_t kMinuteHorizon = 24 * 3600;
+    static constexpr int64_t kRetention = 31 * 24 * 3600;
+};
+
+// Mergeable sketches (HyperLogLog, TDigest) in time buckets. A window is
+// answered by merging every bucket that overlaps it, so the oldest bucket may
+// add values from up to one bucket width before the window start.
+template <typename Sketch>
+class BucketedSketch : public SketchBuckets {
+public:
+    template <typename Value>
+    void Add(int64_t timestamp, const Value& value) {
+        latest_ = std::max(latest_, timestamp);
+        if (timestamp >= latest_ - kMinuteHorizon) {
+            minutes_[timestamp - timestamp % kMinuteBucket].Add(value);
+        } else {
+            hours_[timestamp - timestamp % kHourBucket].Add(value);
+        }
+        Compact();
+    }
+
+    Sketch Collect(int64_t since) const {
+        Sketch merged;
+        for (auto it = hours_.lower_bound(since - since % kHourBucket); it != hours_.end(); ++it) {
+            merged.Merge(it->second);
+        }
+        for (auto it = minutes_.lower_bound(since - since % kMinuteBucket); it != minutes_.end(); ++it) {
+            merged.Merge(it->second);
+        }
+        return merged;
+    }
+
+    void Serialize(BinaryWriter& writer) const {
+        writer.Write(latest_);
+        for (const auto* buckets : {&minutes_, &hours_}) {
+            writer.Write(static_cast<uint32_t>(buckets->size()));
+            for (const auto& [start, sketch] : *buckets) {
+                writer.Write(start);
+                sketch.Serialize(writer);
+            }
+        }
+    }
+
+    static bool Deserialize(BinaryReader& reader, BucketedSketch& sketch) {
+        if (!reader.Read(sketch.latest_)) return false;
+        for (auto* buckets : {&sketch.minutes_, &sketch.hours_}) {
+            uint32_t size = 0;
+            if (!reader.Read(size)) return false;
+            buckets->clear();
+            for (uint32_t i = 0; i < size; ++i) {
+                int64_t start = 0;
+                if (!reader.Read(start) || !Sketch::Deserialize(reader, (*buckets)[start])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    // Moves minute buckets past kMinuteHorizon into hour buckets and drops
+    // hour buckets past kRetention.
+    void Compact() {
+        while (!minutes_.empty() && minutes_.begin()->first < latest_ - kMinuteHorizon) {
+            const auto start = minutes_.begin()->first;
+            hours_[start - start % kHourBucket].Merge(minutes_.begin()->second);
+            minutes_.erase(minutes_.begin());
+        }
+        while (!hours_.empty() && hours_.begin()->first < latest_ - kRetention) {
+            hours_.erase(hours_.begin());
+        }
+    }
+
+    int64_t latest_ = 0;
+    std::map<int64_t, Sketch> minutes_;
+    std::map<int64_t, Sketch> hours_;
+};
+
+// Per-account state kept in memory by the rules_service replica that owns
+// the account's Kafka partition.
+struct AccountState {
+    uint32_t partition = 0;
+    int64_t first_timestamp = 0;
+    int64_t last_timestamp = 0;
+    uint64_t transaction_count = 0;
+    double amount_sum = 0.0;
+    // HyperLogLog::Hash of the ids of the last kRecentTransactions applied
+    // transactions, oldest first; see IsApplied.
+    std::deque<uint64_t> recent_transactions;
+
+    // Complete for the account's transactions since sketch_since: either
+    // applied from Kafka or backfilled from history.
+    std::array<BucketedSketch<HyperLogLog>, kDistinctFieldCount> distinct;
+    BucketedSketch<TDigest> amounts;
+    int64_t sketch_since = 0;
+    // Earliest window start a backfill was started for; not stored in
+    // snapshots. See AccountStateStore::ClaimBackfill.
+    int64_t backfill_since = std::numeric_limits<int64_t>::max();
+
+    // One entry per configured half-life, see AccountStateStore.
+    std::vector<DecayedStats> decayed;
+
+    static constexpr size_t kRecentTransactions = 64;
+
+    void Apply(const transaction::Transaction& tx, int64_t timestamp);
+
+    // Whether the transaction is one of the account's last
+    // kRecentTransactions applied ones. Requests of one transaction span
+    // several Kafka messages and batches, and a restore replays the
+    // partition, so a transaction can arrive more than once; late and
+    // out-of-order transactions are still new and get applied.
+    bool IsApplied(const transaction::Transaction& tx) const;
+
+    // Keeps the decayed stats whose half-life is still configured and starts
+    // empty ones for new half-lives.
+    void ConfigureDecayed(const std::vector<int64_t>& half_lives);
+
+    // Whether the sketches hold every transaction since `since`.
+    bool CoversSketches(int64_t since) const;
+    void BackfillSketches(const std::vector<transaction::Transaction>& history, int64_t since);
+
+    // Binary form stored in state snapshots, see state_snapshot.hpp.
+    void Serialize(std::string& out) const;
+    static bool Deserialize(std::string_view in, AccountState& state);
+
+private:
+    void AddToSketches(const transaction::Transaction& tx, int64_t timestamp);
+};
+
+} // namespace fraud_detection
@@ -0,0 +1,266 @@
+#include "account_state_store.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+AccountStateStore::AccountStateStore(size_t shard_count, std::vector<int64_t> decayed_half_lives)
+    : decayed_half_lives_(std::move(decayed_half_lives)) {
+    shards_.reserve(std::max<size_t>(shard_count, 1));
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+void AccountStateStore::AssignPartitions(const std::vector<uint32_t>& partitions) {
+    std::lock_guard lock(partitions_mutex_);
+    for (auto partition : partitions) {
+        auto [it, inserted] = partitions_.try_emplace(partition);
+        LOG_INFO() << "Account state partition " << partition
+                   << (inserted ? " assigned" : " already owned");
+    }
+}
+
+void AccountStateStore::RevokePartitions(const std::vector<uint32_t>& partitions) {
+    std::unique_lock snapshot_lock(snapshot_mutex_);
+    std::unordered_set<uint32_t> revoked;
+    {
+        std::lock_guard lock(partitions_mutex_);
+        for (auto partition : partitions) {
+            if (partitions_.erase(partition) > 0) {
+                revoked.insert(partition);
+            }
+        }
+    }
+    if (revoked.empty()) {
+        return;
+    }
+
+    size_t dropped = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        dropped += std::erase_if(shard->accounts, [&revoked](const auto& item) {
+            return revoked.count(item.second.partition) > 0;
+        });
+    }
+    LOG_INFO() << "Dropped state of " << dropped << " accounts for "
+               << revoked.size() << " revoked partitions";
+}
+
+void AccountStateStore::RestorePartition(PartitionSnapshot snapshot) {
+    std::unique_lock snapshot_lock(snapshot_mutex_);
+    {
+        std::lock_guard lock(partitions_mutex_);
+        partitions_[snapshot.partition].applied_offset = snapshot.applied_offset;
+    }
+
+    for (auto& [account_id, state] : snapshot.accounts) {
+        auto& shard = ShardFor(account_id);
+        std::lock_guard lock(shard.mutex);
+        state.partition = snapshot.partition;
+        state.ConfigureDecayed(decayed_half_lives_);
+        shard.accounts[account_id] = std::move(state);
+    }
+    LOG_INFO() << "Restored state of " << snapshot.accounts.size() << " accounts for partition "
+               << snapshot.partition << " at offset " << snapshot.applied_offset;
+}
+
+bool AccountStateStore::OwnsPartition(uint32_t partition) const {
+    std::lock_guard lock(partitions_mutex_);
+    return partitions_.count(partition) > 0;
+}
+
+std::vector<uint32_t> AccountStateStore::GetOwnedPartitions() const {
+    std::lock_guard lock(partitions_mutex_);
+    std::vector<uint32_t> owned;
+    owned.reserve(partitions_.size());
+    for (const auto& [partition, info] : partitions_) {
+        owned.push_back(partition);
+    }
+    std::sort(owned.begin(), owned.end());
+    return owned;
+}
+
+std::optional<int64_t> AccountStateStore::GetAppliedOffset(uint32_t partition) const {
+    std::lock_guard lock(partitions_mutex_);
+    auto it = partitions_.find(partition);
+    if (it == partitions_.end()) {
+        return std::nullopt;
+    }
+    return it->second.applied_offset;
+}
+
+bool AccountStateStore::Apply(
+    uint32_t partition,
+    int64_t offset,
+    const transaction::Transaction& tx) {
+    int64_t timestamp = 0;
+    try {
+        timestamp = std::stoll(tx.timestamp());
+    } catch (const std::exception&) {
+        LOG_WARNING() << "Account state: invalid timestamp '" << tx.timestamp()
+                      << "' in transaction " << tx.transaction_id();
+        return false;
+    }
+
+    std::shared_lock snapshot_lock(snapshot_mutex_);
+    {
+        std::lock_guard lock(partitions_mutex_);
+        auto it = partitions_.find(partition);
+        if (it == partitions_.end()) {
+            LOG_DEBUG() << "Account state: partition " << partition << " is not owned";
+            return false;
+        }
+        // Only where a restore resumes; duplicates are detected per account.
+        it->second.applied_offset = std::max(it->second.applied_offset, offset);
+    }
+
+    auto& shard = ShardFor(tx.sender_account());
+    std::lock_guard lock(shard.mutex);
+    auto [it, inserted] = shard.accounts.try_emplace(tx.sender_account());
+    auto& state = it->second;
+    if (inserted) {
+        state.ConfigureDecayed(decayed_half_lives_);
+    }
+    if (state.IsApplied(tx)) {
+        return false;
+    }
+    state.partition = partition;
+    state.Apply(tx, timestamp);
+    return true;
+}
+
+std::optional<AccountState> AccountStateStore::Find(const std::string& account_id) const {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<double> AccountStateStore::EstimateDistinct(
+    const std::string& account_id,
+    DistinctField field,
+    int64_t since,
+    uint8_t precision) const {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end() || !it->second.CoversSketches(since)) {
+        return std::nullopt;
+    }
+    return it->second.distinct[static_cast<size_t>(field)].Collect(since).Estimate(precision);
+}
+
+std::optional<double> AccountStateStore::EstimateAmountQuantile(
+    const std::string& account_id,
+    int64_t since,
+    double q) const {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end() || !it->second.CoversSketches(since)) {
+        return std::nullopt;
+    }
+    return it->second.amounts.Collect(since).Quantile(q);
+}
+
+bool AccountStateStore::ClaimBackfill(const std::string& account_id, int64_t since) {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end()) {
+        return false;
+    }
+    auto& state = it->second;
+    if (state.CoversSketches(since) || since < state.last_timestamp - SketchBuckets::kRetention ||
+        since >= state.backfill_since) {
+        return false;
+    }
+    state.backfill_since = since;
+    return true;
+}
+
+bool AccountStateStore::BackfillSketches(
+    const std::string& account_id,
+    const std::vector<transaction::Transaction>& history,
+    int64_t since) {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end()) {
+        return false;
+    }
+    it->second.BackfillSketches(history, since);
+    LOG_DEBUG() << "Backfilled sketches of account " << account_id << " with "
+                << history.size() << " transactions";
+    return true;
+}
+
+std::vector<DecayedFeatures> AccountStateStore::GetDecayedFeatures(
+    const std::string& account_id,
+    int64_t now,
+    std::string_view location) const {
+    auto& shard = ShardFor(account_id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.accounts.find(account_id);
+    if (it == shard.accounts.end()) {
+        return {};
+    }
+    std::vector<DecayedFeatures> features;
+    features.reserve(it->second.decayed.size());
+    for (const auto& stats : it->second.decayed) {
+        features.push_back(stats.Evaluate(now, location));
+    }
+    return features;
+}
+
+AccountStateStore::Snapshot AccountStateStore::TakeSnapshot() const {
+    std::unique_lock snapshot_lock(snapshot_mutex_);
+
+    Snapshot snapshot;
+    std::unordered_map<uint32_t, size_t> partition_index;
+    {
+        std::lock_guard lock(partitions_mutex_);
+        for (const auto& [partition, info] : partitions_) {
+            partition_index[partition] = snapshot.partitions.size();
+            auto& partition_snapshot = snapshot.partitions.emplace_back();
+            partition_snapshot.partition = partition;
+            partition_snapshot.applied_offset = info.applied_offset;
+        }
+    }
+
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        for (const auto& [account_id, state] : shard->accounts) {
+            auto it = partition_index.find(state.partition);
+            if (it != partition_index.end()) {
+                snapshot.partitions[it->second].accounts.emplace_back(account_id, state);
+            }
+        }
+    }
+    return snapshot;
+}
+
+size_t AccountStateStore::Size() const {
+    size_t size = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        size += shard->accounts.size();
+    }
+    return size;
+}
+
+AccountStateStore::Shard& AccountStateStore::ShardFor(const std::string& account_id) const {
+    return *shards_[std::hash<std::string>{}(account_id) % shards_.size()];
+}
+
+} // namespace fraud_detection
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/shared_mutex.hpp>
+
+#include <transaction/transaction.pb.h>
+
+#include "account_state.hpp"
+
+namespace fraud_detection {
+
+// Owns the state of all accounts whose requests arrive on the Kafka
+// partitions assigned to this replica. Requests are keyed by sender_account,
+// so every account lives on exactly one partition and one replica.
+class AccountStateStore {
+public:
+    struct PartitionSnapshot {
+        uint32_t partition = 0;
+        int64_t applied_offset = -1;
+        std::vector<std::pair<std::string, AccountState>> accounts;
+    };
+
+    struct Snapshot {
+        std::vector<PartitionSnapshot> partitions;
+    };
+
+    // `decayed_half_lives` are the half-lives, in seconds, of the decayed
+    // statistics kept for every account.
+    explicit AccountStateStore(size_t shard_count = 64, std::vector<int64_t> decayed_half_lives = {});
+
+    // Called from the consumer rebalance callback.
+    void AssignPartitions(const std::vector<uint32_t>& partitions);
+    void RevokePartitions(const std::vector<uint32_t>& partitions);
+
+    // Takes ownership of a partition together with state restored from a
+    // snapshot. Messages up to applied_offset are already reflected in it.
+    void RestorePartition(PartitionSnapshot snapshot);
+
+    bool OwnsPartition(uint32_t partition) const;
+    std::vector<uint32_t> GetOwnedPartitions() const;
+    std::optional<int64_t> GetAppliedOffset(uint32_t partition) const;
+
+    // Applies the transaction to its sender's state unless the state holds it
+    // already (AccountState::IsApplied), so a transaction is counted once
+    // however many rule requests carry it and replays are safe. Returns
+    // whether it was applied.
+    bool Apply(uint32_t partition, int64_t offset, const transaction::Transaction& tx);
+
+    std::optional<AccountState> Find(const std::string& account_id) const;
+
+    // Estimated number of distinct values of `field` in the account's
+    // transactions since `since`. std::nullopt when the account is not held by
+    // this replica or its sketches do not reach back to `since`.
+    std::optional<double> EstimateDistinct(
+        const std::string& account_id,
+        DistinctField field,
+        int64_t since,
+        uint8_t precision) const;
+
+    // Estimated `q` quantile (0..1) of the account's transaction amounts since
+    // `since`, with the same coverage rules as EstimateDistinct.
+    std::optional<double> EstimateAmountQuantile(
+        const std::string& account_id,
+        int64_t since,
+        double q) const;
+
+    // Whether the caller should load the account's history since `since` and
+    // pass it to BackfillSketches. False when the account is not held by this
+    // replica, its sketches already cover `since`, the window is longer than
+    // they can keep, or a backfill reaching `since` was already started;
+    // otherwise records the backfill so that concurrent and later evaluations
+    // of the window do not load the history again.
+    bool ClaimBackfill(const std::string& account_id, int64_t since);
+
+    // Adds transactions loaded from history to the account's sketches so that
+    // they cover everything since `since`. Returns false when the account is
+    // not held by this replica.
+    bool BackfillSketches(
+        const std::string& account_id,
+        const std::vector<transaction::Transaction>& history,
+        int64_t since);
+
+    // Decayed features of the account as of `now` for every configured
+    // half-life. Empty when the account is not held by this replica.
+    std::vector<DecayedFeatures> GetDecayedFeatures(
+        const std::string& account_id,
+        int64_t now,
+        std::string_view location) const;
+
+    const std::vector<int64_t>& GetDecayedHalfLives() const { return decayed_half_lives_; }
+
+    // Copies the state of all owned partitions. Applies are blocked while the
+    // copy is taken, so offsets and account state always match each other.
+    Snapshot TakeSnapshot() const;
+
+    size_t Size() const;
+
+private:
+    struct Shard {
+        mutable userver::engine::Mutex mutex;
+        std::unordered_map<std::string, AccountState> accounts;
+    };
+
+    struct PartitionInfo {
+        int64_t applied_offset = -1;
+    };
+
+    Shard& ShardFor(const std::string& account_id) const;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    const std::vector<int64_t> decayed_half_lives_;
+
+    // Shared by Apply, exclusive for snapshots.
+    mutable userver::engine::SharedMutex snapshot_mutex_;
+
+    mutable userver::engine::Mutex partitions_mutex_;
+    std::unordered_map<uint32_t, PartitionInfo> partitions_;
+};
+
+} // namespace fraud_detection
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace fraud_detection {
+
+// Minimal native-endian encoding used by the local state snapshot files.
+// Snapshots never leave the host that wrote them, so no byte swapping.
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) : out_(out) {}
+
+    template <typename T>
+    void Write(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(std::string_view value) {
+        Write<uint32_t>(static_cast<uint32_t>(value.size()));
+        out_.append(value.data(), value.size());
+    }
+
+    void WriteBytes(const void* data, size_t size) {
+        out_.append(static_cast<const char*>(data), size);
+    }
+
+    size_t Size() const { return out_.size(); }
+
+private:
+    std::string& out_;
+};
+
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view in) : in_(in) {}
+
+    template <typename T>
+    bool Read(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (in_.size() < sizeof(T)) return false;
+        std::memcpy(&value, in_.data(), sizeof(T));
+        in_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool ReadString(std::string& value) {
+        std::string_view view;
+        if (!ReadStringView(view)) return false;
+        value.assign(view.data(), view.size());
+        return true;
+    }
+
+    bool ReadStringView(std::string_view& value) {
+        uint32_t size = 0;
+        if (!Read(size) || in_.size() < size) return false;
+        value = in_.substr(0, size);
+        in_.remove_prefix(size);
+        return true;
+    }
+
+    bool ReadBytes(void* data, size_t size) {
+        if (in_.size() < size) return false;
+        std::memcpy(data, in_.data(), size);
+        in_.remove_prefix(size);
+        return true;
+    }
+
+    bool Empty() const { return in_.empty(); }
+
+private:
+    std::string_view in_;
+};
+
+} // namespace fraud_detection
@@ -0,0 +1,112 @@
+#include "decayed_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hyperloglog.hpp"
+
+namespace fraud_detection {
+
+namespace {
+
+// Weighted incremental mean and sum of squared deviations (West, 1979).
+void AddWeighted(double& mean, double& m2, double total_weight, double value, double weight) {
+    const double delta = value - mean;
+    mean += weight * delta / total_weight;
+    m2 += weight * delta * (value - mean);
+}
+
+double Std(double m2, double weight) {
+    return weight > 0.0 ? std::sqrt(std::max(0.0, m2 / weight)) : 0.0;
+}
+
+}  // namespace
+
+double DecayedStats::Decay(int64_t seconds) const {
+    if (half_life_ <= 0) {
+        return 1.0;
+    }
+    return std::exp2(-static_cast<double>(seconds) / static_cast<double>(half_life_));
+}
+
+void DecayedStats::Add(int64_t timestamp, double amount, std::string_view location) {
+    double weight = 1.0;
+    if (weight_ == 0.0 || timestamp >= updated_at_) {
+        // Age the state to the new transaction instead of aging every
+        // transaction at read time.
+        const double factor = weight_ == 0.0 ? 1.0 : Decay(timestamp - updated_at_);
+        weight_ *= factor;
+        amount_m2_ *= factor;
+        log_amount_m2_ *= factor;
+        for (auto& entry : locations_) {
+            entry.weight *= factor;
+        }
+        updated_at_ = timestamp;
+    } else {
+        // Late transaction: weigh it as already aged.
+        weight = Decay(updated_at_ - timestamp);
+    }
+
+    weight_ += weight;
+    AddWeighted(amount_mean_, amount_m2_, weight_, amount, weight);
+    AddWeighted(log_amount_mean_, log_amount_m2_, weight_, std::log1p(std::max(0.0, amount)), weight);
+
+    const auto location_hash = HyperLogLog::Hash(location);
+    auto slot = std::find_if(locations_.begin(), locations_.end(), [&](const LocationWeight& entry) {
+        return entry.weight > 0.0 && entry.hash == location_hash;
+    });
+    if (slot == locations_.end()) {
+        slot = std::min_element(locations_.begin(), locations_.end(),
+            [](const LocationWeight& a, const LocationWeight& b) { return a.weight < b.weight; });
+        *slot = LocationWeight{location_hash, 0.0};
+    }
+    slot->weight += weight;
+}
+
+DecayedFeatures DecayedStats::Evaluate(int64_t now, std::string_view location) const {
+    DecayedFeatures features;
+    features.half_life = half_life_;
+    if (weight_ == 0.0) {
+        return features;
+    }
+
+    const double weight = weight_ * Decay(std::max<int64_t>(0, now - updated_at_));
+    // A decayed count over the half-life is the rate times half_life / ln 2.
+    features.rate = half_life_ > 0 ? weight * std::log(2.0) * 3600.0 / static_cast<double>(half_life_) : 0.0;
+    features.amount_mean = amount_mean_;
+    features.amount_std = Std(amount_m2_, weight_);
+    features.log_amount_mean = log_amount_mean_;
+    features.log_amount_std = Std(log_amount_m2_, weight_);
+
+    const auto location_hash = HyperLogLog::Hash(location);
+    for (const auto& entry : locations_) {
+        if (entry.weight > 0.0 && entry.hash == location_hash) {
+            features.location_frequency = std::min(1.0, entry.weight / weight_);
+        }
+    }
+    return features;
+}
+
+void DecayedStats::Serialize(BinaryWriter& writer) const {
+    writer.Write(half_life_);
+    writer.Write(updated_at_);
+    writer.Write(weight_);
+    writer.Write(amount_mean_);
+    writer.Write(amount_m2_);
+    writer.Write(log_amount_mean_);
+    writer.Write(log_amount_m2_);
+    writer.Write(locations_);
+}
+
+bool DecayedStats::Deserialize(BinaryReader& reader, DecayedStats& stats) {
+    return reader.Read(stats.half_life_) &&
+           reader.Read(stats.updated_at_) &&
+           reader.Read(stats.weight_) &&
+           reader.Read(stats.amount_mean_) &&
+           reader.Read(stats.amount_m2_) &&
+           reader.Read(stats.log_amount_mean_) &&
+           reader.Read(stats.log_amount_m2_) &&
+           reader.Read(stats.locations_);
+}
+
+}  // namespace fraud_detection
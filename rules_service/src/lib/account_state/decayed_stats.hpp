@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "binary_io.hpp"
+
+namespace fraud_detection {
+
+// Decayed features of an account for one half-life, as of a point in time.
+struct DecayedFeatures {
+    int64_t half_life = 0;
+    // Transactions per hour.
+    double rate = 0.0;
+    double amount_mean = 0.0;
+    double amount_std = 0.0;
+    double log_amount_mean = 0.0;
+    double log_amount_std = 0.0;
+    // Share of the decayed weight made from the queried location, 0..1.
+    double location_frequency = 0.0;
+};
+
+// Exponentially time-decayed statistics of an account's transactions: each
+// transaction's weight halves every half_life seconds. The state is a fixed
+// handful of numbers whatever the account's volume, and needs no history.
+// Locations are tracked for the kMaxLocations heaviest ones only; a new
+// location replaces the lightest, so rarely used locations read as unseen.
+class DecayedStats {
+public:
+    static constexpr size_t kMaxLocations = 8;
+
+    explicit DecayedStats(int64_t half_life = 0) : half_life_(half_life) {}
+
+    int64_t HalfLife() const { return half_life_; }
+
+    void Add(int64_t timestamp, double amount, std::string_view location);
+
+    DecayedFeatures Evaluate(int64_t now, std::string_view location) const;
+
+    void Serialize(BinaryWriter& writer) const;
+    static bool Deserialize(BinaryReader& reader, DecayedStats& stats);
+
+private:
+    double Decay(int64_t seconds) const;
+
+    int64_t half_life_ = 0;
+    int64_t updated_at_ = 0;
+    double weight_ = 0.0;
+    double amount_mean_ = 0.0;
+    double amount_m2_ = 0.0;
+    double log_amount_mean_ = 0.0;
+    double log_amount_m2_ = 0.0;
+    struct LocationWeight {
+        uint64_t hash = 0;
+        double weight = 0.0;  // 0 marks a free slot
+    };
+
+    std::array<LocationWeight, kMaxLocations> locations_{};
+};
+
+}  // namespace fraud_detection
@@ -0,0 +1,156 @@
+#include "hyperloglog.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace fraud_detection {
+
+namespace {
+
+constexpr uint8_t kSparseMode = 0;
+constexpr uint8_t kDenseMode = 1;
+
+constexpr uint32_t EntryIndex(uint32_t entry) { return entry >> 6; }
+constexpr uint8_t EntryRank(uint32_t entry) { return static_cast<uint8_t>(entry & 0x3f); }
+constexpr uint32_t MakeEntry(uint32_t index, uint8_t rank) { return (index << 6) | rank; }
+
+template <typename Fn>
+void ForEachRegister(const std::vector<uint32_t>& sparse, const std::vector<uint8_t>& dense, Fn&& fn) {
+    if (!dense.empty()) {
+        for (uint32_t index = 0; index < dense.size(); ++index) {
+            if (dense[index] != 0) {
+                fn(index, dense[index]);
+            }
+        }
+        return;
+    }
+    for (auto entry : sparse) {
+        fn(EntryIndex(entry), EntryRank(entry));
+    }
+}
+
+}  // namespace
+
+uint64_t HyperLogLog::Hash(std::string_view value) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    // FNV alone mixes the high bits poorly; finish with the murmur3 finalizer.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void HyperLogLog::Add(uint64_t hash) {
+    const auto index = static_cast<uint32_t>(hash >> (64 - kMaxPrecision));
+    const uint64_t rest = hash << kMaxPrecision;
+    const auto rank = static_cast<uint8_t>(
+        rest == 0 ? 64 - kMaxPrecision + 1 : std::countl_zero(rest) + 1);
+    SetRegister(index, rank);
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+    if (!other.dense_.empty() && dense_.empty()) {
+        ToDense();
+    }
+    ForEachRegister(other.sparse_, other.dense_, [this](uint32_t index, uint8_t rank) {
+        SetRegister(index, rank);
+    });
+}
+
+double HyperLogLog::Estimate(uint8_t precision) const {
+    precision = std::clamp(precision, kMinPrecision, kMaxPrecision);
+    const uint32_t shift = kMaxPrecision - precision;
+    const uint32_t m = 1u << precision;
+
+    // Fold the registers: the dropped low bits of the index become the
+    // leading bits of the remaining hash.
+    std::vector<uint8_t> registers(m, 0);
+    ForEachRegister(sparse_, dense_, [&](uint32_t index, uint8_t rank) {
+        uint8_t folded = rank;
+        if (shift > 0) {
+            const uint32_t low = index & ((1u << shift) - 1);
+            folded = low != 0 ? static_cast<uint8_t>(shift - std::bit_width(low) + 1)
+                              : static_cast<uint8_t>(shift + rank);
+        }
+        auto& reg = registers[index >> shift];
+        reg = std::max(reg, folded);
+    });
+
+    double sum = 0.0;
+    uint32_t zeros = 0;
+    for (auto reg : registers) {
+        sum += std::ldexp(1.0, -static_cast<int>(reg));
+        zeros += reg == 0;
+    }
+
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    if (m == 16) alpha = 0.673;
+    else if (m == 32) alpha = 0.697;
+    else if (m == 64) alpha = 0.709;
+
+    const double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        return m * std::log(static_cast<double>(m) / zeros);
+    }
+    return estimate;
+}
+
+void HyperLogLog::Serialize(BinaryWriter& writer) const {
+    if (!dense_.empty()) {
+        writer.Write(kDenseMode);
+        writer.WriteBytes(dense_.data(), dense_.size());
+        return;
+    }
+    writer.Write(kSparseMode);
+    writer.Write(static_cast<uint32_t>(sparse_.size()));
+    writer.WriteBytes(sparse_.data(), sparse_.size() * sizeof(uint32_t));
+}
+
+bool HyperLogLog::Deserialize(BinaryReader& reader, HyperLogLog& sketch) {
+    uint8_t mode = 0;
+    if (!reader.Read(mode)) return false;
+    sketch.sparse_.clear();
+    sketch.dense_.clear();
+    if (mode == kDenseMode) {
+        sketch.dense_.resize(kRegisterCount);
+        return reader.ReadBytes(sketch.dense_.data(), sketch.dense_.size());
+    }
+    uint32_t size = 0;
+    if (mode != kSparseMode || !reader.Read(size) || size > kSparseLimit) return false;
+    sketch.sparse_.resize(size);
+    return reader.ReadBytes(sketch.sparse_.data(), size * sizeof(uint32_t));
+}
+
+void HyperLogLog::SetRegister(uint32_t index, uint8_t rank) {
+    if (!dense_.empty()) {
+        dense_[index] = std::max(dense_[index], rank);
+        return;
+    }
+    auto it = std::lower_bound(sparse_.begin(), sparse_.end(), MakeEntry(index, 0));
+    if (it != sparse_.end() && EntryIndex(*it) == index) {
+        *it = MakeEntry(index, std::max(EntryRank(*it), rank));
+        return;
+    }
+    sparse_.insert(it, MakeEntry(index, rank));
+    if (sparse_.size() > kSparseLimit) {
+        ToDense();
+    }
+}
+
+void HyperLogLog::ToDense() {
+    dense_.assign(kRegisterCount, 0);
+    for (auto entry : sparse_) {
+        dense_[EntryIndex(entry)] = EntryRank(entry);
+    }
+    sparse_.clear();
+    sparse_.shrink_to_fit();
+}
+
+}  // namespace fraud_detection
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "binary_io.hpp"
+
+namespace fraud_detection {
+
+// HyperLogLog distinct-value sketch. Registers are kept at kMaxPrecision and
+// folded down when a rule asks for a lower precision, so one sketch serves
+// every rule. Small sketches stay sparse (one entry per non-empty register)
+// and switch to a dense register array once that is smaller.
+class HyperLogLog {
+public:
+    static constexpr uint8_t kMinPrecision = 4;
+    // 2^14 registers, about 0.8% standard error.
+    static constexpr uint8_t kMaxPrecision = 14;
+
+    static uint64_t Hash(std::string_view value);
+
+    void Add(uint64_t hash);
+    void Merge(const HyperLogLog& other);
+
+    // Estimated number of distinct values at the given precision, clamped to
+    // [kMinPrecision, kMaxPrecision].
+    double Estimate(uint8_t precision = kMaxPrecision) const;
+
+    bool Empty() const { return sparse_.empty() && dense_.empty(); }
+
+    void Serialize(BinaryWriter& writer) const;
+    static bool Deserialize(BinaryReader& reader, HyperLogLog& sketch);
+
+private:
+    static constexpr uint32_t kRegisterCount = 1u << kMaxPrecision;
+    // A sparse entry packs the register index above its 6-bit rank.
+    static constexpr size_t kSparseLimit = kRegisterCount / sizeof(uint32_t);
+
+    void SetRegister(uint32_t index, uint8_t rank);
+    void ToDense();
+
+    std::vector<uint32_t> sparse_;  // sorted by register index
+    std::vector<uint8_t> dense_;
+};
+
+}  // namespace fraud_detection
@@ -0,0 +1,204 @@
+#include "state_snapshot.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <userver/logging/log.hpp>
+
+#include "binary_io.hpp"
+
+namespace fraud_detection {
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'R', 'A', 'D', 'S', 'N', 'A', 'P'};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t partition_count;
+    uint64_t account_count;
+    uint64_t payload_size;
+    uint64_t payload_checksum;
+};
+
+uint64_t Fnv1a(std::string_view data) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                data_ = static_cast<const char*>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+                ::madvise(addr, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view View() const { return {data_, size_}; }
+    bool IsOpen() const { return data_ != nullptr; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // anonymous namespace
+
+StateSnapshotFile::StateSnapshotFile(std::string path) : path_(std::move(path)) {}
+
+bool StateSnapshotFile::Write(const AccountStateStore::Snapshot& snapshot) const {
+    std::string payload;
+    BinaryWriter writer(payload);
+    uint64_t account_count = 0;
+    std::string state_buffer;
+    for (const auto& partition : snapshot.partitions) {
+        writer.Write(partition.partition);
+        writer.Write(partition.applied_offset);
+        writer.Write<uint64_t>(partition.accounts.size());
+        for (const auto& [account_id, state] : partition.accounts) {
+            state_buffer.clear();
+            state.Serialize(state_buffer);
+            writer.WriteString(account_id);
+            writer.WriteString(state_buffer);
+        }
+        account_count += partition.accounts.size();
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.partition_count = static_cast<uint32_t>(snapshot.partitions.size());
+    header.account_count = account_count;
+    header.payload_size = payload.size();
+    header.payload_checksum = Fnv1a(payload);
+
+    const auto dir = std::filesystem::path(path_).parent_path();
+    if (!dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+    }
+
+    const std::string tmp_path = path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR() << "Cannot open state snapshot file " << tmp_path << ": " << std::strerror(errno);
+        return false;
+    }
+    bool ok = WriteAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+              WriteAll(fd, payload.data(), payload.size()) &&
+              ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        LOG_ERROR() << "Failed to write state snapshot " << path_ << ": " << std::strerror(errno);
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+
+    int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+
+    LOG_INFO() << "Wrote state snapshot " << path_ << ": " << snapshot.partitions.size()
+               << " partitions, " << account_count << " accounts, "
+               << sizeof(header) + payload.size() << " bytes";
+    return true;
+}
+
+std::optional<AccountStateStore::Snapshot> StateSnapshotFile::Read() const {
+    MappedFile file(path_);
+    if (!file.IsOpen()) {
+        LOG_INFO() << "No state snapshot found at " << path_;
+        return std::nullopt;
+    }
+
+    auto data = file.View();
+    SnapshotHeader header{};
+    if (data.size() < sizeof(header)) {
+        LOG_WARNING() << "State snapshot " << path_ << " is truncated";
+        return std::nullopt;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kFormatVersion) {
+        LOG_WARNING() << "State snapshot " << path_ << " has unsupported format version " << header.version;
+        return std::nullopt;
+    }
+
+    auto payload = data.substr(sizeof(header));
+    if (payload.size() != header.payload_size || Fnv1a(payload) != header.payload_checksum) {
+        LOG_WARNING() << "State snapshot " << path_ << " failed checksum validation";
+        return std::nullopt;
+    }
+
+    AccountStateStore::Snapshot snapshot;
+    snapshot.partitions.reserve(header.partition_count);
+    BinaryReader reader(payload);
+    for (uint32_t i = 0; i < header.partition_count; ++i) {
+        auto& partition = snapshot.partitions.emplace_back();
+        uint64_t account_count = 0;
+        if (!reader.Read(partition.partition) || !reader.Read(partition.applied_offset) ||
+            !reader.Read(account_count)) {
+            LOG_WARNING() << "State snapshot " << path_ << " is corrupted";
+            return std::nullopt;
+        }
+        partition.accounts.reserve(account_count);
+        for (uint64_t j = 0; j < account_count; ++j) {
+            std::string account_id;
+            std::string_view state_bytes;
+            AccountState state;
+            if (!reader.ReadString(account_id) || !reader.ReadStringView(state_bytes) ||
+                !AccountState::Deserialize(state_bytes, state)) {
+                LOG_WARNING() << "State snapshot " << path_ << " is corrupted";
+                return std::nullopt;
+            }
+            state.partition = partition.partition;
+            partition.accounts.emplace_back(std::move(account_id), std::move(state));
+        }
+    }
+
+    LOG_INFO() << "Loaded state snapshot " << path_ << ": " << header.partition_count
+               << " partitions, " << header.account_count << " accounts";
+    return snapshot;
+}
+
+} // namespace fraud_detection
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "account_state_store.hpp"
+
+namespace fraud_detection {
+
+// Local snapshot file of the account state store.
+//
+// Layout: a fixed header (magic, format version, counts, payload size and
+// checksum) followed by the payload with one record per owned partition:
+// partition id, last applied Kafka offset and the serialized account states.
+//
+// Writes go to a temporary file that is fsync'ed and renamed over the old
+// snapshot, so a crash leaves either the previous or the new snapshot on
+// disk. Reads mmap the file and decode it in place. Both calls block and
+// must run on a blocking task processor.
+class StateSnapshotFile {
+public:
+    static constexpr uint32_t kFormatVersion = 6;
+
+    explicit StateSnapshotFile(std::string path);
+
+    bool Write(const AccountStateStore::Snapshot& snapshot) const;
+    std::optional<AccountStateStore::Snapshot> Read() const;
+
+    const std::string& GetPath() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+} // namespace fraud_detection
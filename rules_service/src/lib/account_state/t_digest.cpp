@@ -0,0 +1,160 @@
+#include "t_digest.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fraud_detection {
+
+void TDigest::Add(double value, double weight) {
+    if (!std::isfinite(value) || weight <= 0.0) {
+        return;
+    }
+    if (Empty()) {
+        min_ = max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    buffer_.push_back({value, weight});
+    buffer_weight_ += weight;
+    if (buffer_.size() >= kBufferLimit) {
+        Compress();
+    }
+}
+
+void TDigest::Merge(const TDigest& other) {
+    if (other.Empty()) {
+        return;
+    }
+    if (Empty()) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    for (const auto* source : {&other.centroids_, &other.buffer_}) {
+        for (const auto& centroid : *source) {
+            buffer_.push_back(centroid);
+            buffer_weight_ += centroid.weight;
+        }
+    }
+    if (buffer_.size() >= kBufferLimit) {
+        Compress();
+    }
+}
+
+void TDigest::Compress() {
+    if (buffer_.empty()) {
+        return;
+    }
+    buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+    std::sort(buffer_.begin(), buffer_.end(), [](const Centroid& a, const Centroid& b) {
+        return a.mean < b.mean;
+    });
+
+    const double total = total_weight_ + buffer_weight_;
+    centroids_.clear();
+    Centroid current = buffer_.front();
+    double weight_before = 0.0;
+    for (size_t i = 1; i < buffer_.size(); ++i) {
+        const auto& next = buffer_[i];
+        // A centroid may hold at most 4 * n * q * (1 - q) / compression
+        // values, checked at both of its ends.
+        const double q_left = weight_before / total;
+        const double q_right = (weight_before + current.weight + next.weight) / total;
+        const double limit =
+            4.0 * total * std::min(q_left * (1.0 - q_left), q_right * (1.0 - q_right)) / kCompression;
+        if (current.weight + next.weight <= limit) {
+            const double weight = current.weight + next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / weight;
+            current.weight = weight;
+        } else {
+            weight_before += current.weight;
+            centroids_.push_back(current);
+            current = next;
+        }
+    }
+    centroids_.push_back(current);
+
+    buffer_.clear();
+    total_weight_ = total;
+    buffer_weight_ = 0.0;
+}
+
+double TDigest::Quantile(double q) const {
+    if (!buffer_.empty()) {
+        TDigest compressed = *this;
+        compressed.Compress();
+        return compressed.Quantile(q);
+    }
+    if (centroids_.empty()) {
+        return 0.0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    if (centroids_.size() == 1) {
+        return centroids_.front().mean;
+    }
+
+    // Each centroid's mean sits at the middle of its weight; interpolate
+    // between neighbouring middles and towards min/max at the tails.
+    const double target = q * total_weight_;
+    const auto& first = centroids_.front();
+    if (target < first.weight / 2.0) {
+        return min_ + (first.mean - min_) * target / (first.weight / 2.0);
+    }
+
+    double weight_before = 0.0;
+    for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+        const auto& left = centroids_[i];
+        const auto& right = centroids_[i + 1];
+        const double left_middle = weight_before + left.weight / 2.0;
+        const double right_middle = weight_before + left.weight + right.weight / 2.0;
+        if (target < right_middle) {
+            const double t = (target - left_middle) / (right_middle - left_middle);
+            return left.mean + (right.mean - left.mean) * t;
+        }
+        weight_before += left.weight;
+    }
+
+    const auto& last = centroids_.back();
+    const double last_middle = total_weight_ - last.weight / 2.0;
+    const double t = (target - last_middle) / (last.weight / 2.0);
+    return last.mean + (max_ - last.mean) * std::min(t, 1.0);
+}
+
+void TDigest::Serialize(BinaryWriter& writer) const {
+    if (!buffer_.empty()) {
+        TDigest compressed = *this;
+        compressed.Compress();
+        compressed.Serialize(writer);
+        return;
+    }
+    writer.Write(min_);
+    writer.Write(max_);
+    writer.Write(static_cast<uint32_t>(centroids_.size()));
+    for (const auto& centroid : centroids_) {
+        writer.Write(centroid.mean);
+        writer.Write(centroid.weight);
+    }
+}
+
+bool TDigest::Deserialize(BinaryReader& reader, TDigest& digest) {
+    uint32_t size = 0;
+    if (!reader.Read(digest.min_) || !reader.Read(digest.max_) || !reader.Read(size)) {
+        return false;
+    }
+    digest.buffer_.clear();
+    digest.buffer_weight_ = 0.0;
+    digest.centroids_.resize(size);
+    digest.total_weight_ = 0.0;
+    for (auto& centroid : digest.centroids_) {
+        if (!reader.Read(centroid.mean) || !reader.Read(centroid.weight)) {
+            return false;
+        }
+        digest.total_weight_ += centroid.weight;
+    }
+    return true;
+}
+
+}  // namespace fraud_detection
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "binary_io.hpp"
+
+namespace fraud_detection {
+
+// Merging t-digest (Dunning) for streaming quantiles. Values are buffered and
+// merged into centroids whose size shrinks towards both tails, so extreme
+// quantiles such as p99 stay accurate with about kCompression centroids.
+// Digests merge, which lets time buckets be combined into any window.
+class TDigest {
+public:
+    static constexpr double kCompression = 100.0;
+
+    void Add(double value, double weight = 1.0);
+    void Merge(const TDigest& other);
+
+    // Value below which the fraction `q` (0..1) of the added values lie,
+    // interpolated between centroids. 0 when the digest is empty.
+    double Quantile(double q) const;
+
+    double Count() const { return total_weight_ + buffer_weight_; }
+    bool Empty() const { return Count() == 0.0; }
+
+    void Serialize(BinaryWriter& writer) const;
+    static bool Deserialize(BinaryReader& reader, TDigest& digest);
+
+private:
+    struct Centroid {
+        double mean = 0.0;
+        double weight = 0.0;
+    };
+
+    static constexpr size_t kBufferLimit = 5 * static_cast<size_t>(kCompression);
+
+    // Merges the buffered values into the centroids.
+    void Compress();
+
+    std::vector<Centroid> centroids_;  // sorted by mean
+    std::vector<Centroid> buffer_;
+    double total_weight_ = 0.0;
+    double buffer_weight_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+}  // namespace fraud_detection
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "rule_interface/IRule.hpp"
+#include "rule_utils/evaluation_planner.hpp"
 #include "rule_utils/expression_evaluator.hpp"
 #include <rules/rule_config.pb.h>
 #include <transaction/transaction.pb.h>
@@ -11,7 +12,12 @@ namespace fraud_detection {
 class CompositeRuleAnalyzer : public IRule {
 public:
     explicit CompositeRuleAnalyzer(const rules::RuleConfig& rule_config)
-        : rule_config_(rule_config) {}
+        : rule_config_(rule_config),
+          planner_(rule_config_.composite_rule().expression(), [](const rules::Expression& expr) {
+              return expr.expr_case() == rules::Expression::kLiteral
+                  ? rule_utils::EvaluationPlanner::kLiteralCost
+                  : rule_utils::EvaluationPlanner::kFieldCost;
+          }) {}
 
     bool IsFraudTransaction(const transaction::Transaction& transaction) const override {
         if (!rule_config_.has_composite_rule()) {
@@ -20,6 +26,10 @@ public:
         return EvaluateExpression(transaction, rule_config_.composite_rule().expression());
     }
 
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const override {
+        planner_.WriteStatistics(writer);
+    }
+
 private:
     using ExpressionValue = rule_utils::ExpressionValue;
 
@@ -81,23 +91,17 @@ private:
     bool EvaluateAnd(
         const transaction::Transaction& transaction,
         const rules::LogicalOperation& logical) const {
-        for (const auto& operand : logical.operands()) {
-            if (!EvaluateExpression(transaction, operand)) {
-                return false;
-            }
-        }
-        return true;
+        return planner_.Evaluate(logical, [&](const rules::Expression& operand) {
+            return EvaluateExpression(transaction, operand);
+        });
     }
 
     bool EvaluateOr(
         const transaction::Transaction& transaction,
         const rules::LogicalOperation& logical) const {
-        for (const auto& operand : logical.operands()) {
-            if (EvaluateExpression(transaction, operand)) {
-                return true;
-            }
-        }
-        return false;
+        return planner_.Evaluate(logical, [&](const rules::Expression& operand) {
+            return EvaluateExpression(transaction, operand);
+        });
     }
 
     bool EvaluateNot(
@@ -110,6 +114,7 @@ private:
     }
 
     const rules::RuleConfig rule_config_;
+    const rule_utils::EvaluationPlanner planner_;
 };
 
 }
@@ -0,0 +1,72 @@
+#include "cached_history_provider.hpp"
+
+#include <userver/engine/task/local_variable.hpp>
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+userver::engine::TaskLocalVariable<CachedHistoryProvider*> current_cache;
+
+} // anonymous namespace
+
+std::vector<transaction::Transaction> CachedHistoryProvider::GetAccountHistory(
+    const std::string& account_id,
+    int64_t before_timestamp) {
+
+    for (const auto& entry : histories_) {
+        if (entry.account_id == account_id && entry.before_timestamp == before_timestamp) {
+            LOG_DEBUG() << "Reusing cached history for account " << account_id;
+            return entry.history;
+        }
+    }
+
+    auto& entry = histories_.emplace_back(HistoryEntry{
+        account_id, before_timestamp, upstream_.GetAccountHistory(account_id, before_timestamp)});
+    return entry.history;
+}
+
+HistoryColumns CachedHistoryProvider::GetAccountHistoryColumns(
+    const std::string& account_id,
+    int64_t before_timestamp) {
+
+    for (const auto& entry : columns_) {
+        if (entry.account_id == account_id && entry.before_timestamp == before_timestamp) {
+            LOG_DEBUG() << "Reusing cached history columns for account " << account_id;
+            return entry.columns;
+        }
+    }
+
+    auto& entry = columns_.emplace_back(ColumnsEntry{
+        account_id, before_timestamp, upstream_.GetAccountHistoryColumns(account_id, before_timestamp)});
+    return entry.columns;
+}
+
+std::optional<AccountStats> CachedHistoryProvider::FindAccountStats(const AccountStatsKey& key) {
+    for (const auto& [cached_key, stats] : stats_) {
+        if (cached_key == key) {
+            return stats;
+        }
+    }
+    return std::nullopt;
+}
+
+void CachedHistoryProvider::StoreAccountStats(const AccountStatsKey& key, const AccountStats& stats) {
+    stats_.emplace_back(key, stats);
+}
+
+CachedHistoryProvider::Scope::Scope(CachedHistoryProvider& cache)
+    : previous_(*current_cache) {
+    *current_cache = &cache;
+}
+
+CachedHistoryProvider::Scope::~Scope() {
+    *current_cache = previous_;
+}
+
+CachedHistoryProvider* CachedHistoryProvider::Current() {
+    return *current_cache;
+}
+
+} // namespace fraud_detection
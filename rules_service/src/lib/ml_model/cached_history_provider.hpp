@@ -0,0 +1,69 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "ml_fraud_detector.hpp"
+
+namespace fraud_detection {
+
+// Request-scoped cache in front of the upstream provider: every ML rule and
+// model evaluated for one transaction shares a single history query per
+// (account, before_timestamp) and a single AccountStats computation.
+// Not thread-safe: an instance lives for one transaction group.
+class CachedHistoryProvider : public TransactionHistoryProvider {
+public:
+    explicit CachedHistoryProvider(TransactionHistoryProvider& upstream)
+        : upstream_(upstream) {}
+
+    ~CachedHistoryProvider() override = default;
+
+    std::vector<transaction::Transaction> GetAccountHistory(
+        const std::string& account_id,
+        int64_t before_timestamp) override;
+    HistoryColumns GetAccountHistoryColumns(
+        const std::string& account_id,
+        int64_t before_timestamp) override;
+
+    std::optional<AccountStats> FindAccountStats(const AccountStatsKey& key) override;
+    void StoreAccountStats(const AccountStatsKey& key, const AccountStats& stats) override;
+
+    // Makes `cache` the request cache of the current task for its lifetime,
+    // so that rules built without a request context (MlRuleAnalyzer) share
+    // it too.
+    class Scope {
+    public:
+        explicit Scope(CachedHistoryProvider& cache);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CachedHistoryProvider* previous_;
+    };
+
+    // The cache of the enclosing Scope of the current task, nullptr outside.
+    static CachedHistoryProvider* Current();
+
+private:
+    struct HistoryEntry {
+        std::string account_id;
+        int64_t before_timestamp = 0;
+        std::vector<transaction::Transaction> history;
+    };
+
+    struct ColumnsEntry {
+        std::string account_id;
+        int64_t before_timestamp = 0;
+        HistoryColumns columns;
+    };
+
+    TransactionHistoryProvider& upstream_;
+    // A transaction group touches one or two keys, so linear scans win.
+    std::vector<HistoryEntry> histories_;
+    std::vector<ColumnsEntry> columns_;
+    std::vector<std::pair<AccountStatsKey, AccountStats>> stats_;
+};
+
+} // namespace fraud_detection
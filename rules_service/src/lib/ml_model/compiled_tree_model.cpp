@@ -0,0 +1,43 @@
+#include "compiled_tree_model.hpp"
+
+#include <dlfcn.h>
+
+#include <filesystem>
+
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+CompiledTreeModel::~CompiledTreeModel() {
+    dlclose(handle_);
+}
+
+std::unique_ptr<CompiledTreeModel> CompiledTreeModel::Load(const std::string& path, size_t num_features) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return nullptr;
+    }
+
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        LOG_WARNING() << "Cannot load compiled model " << path << ": " << dlerror();
+        return nullptr;
+    }
+
+    auto num_features_fn = reinterpret_cast<int (*)()>(dlsym(handle, "fraud_model_num_features"));
+    auto predict_fn = reinterpret_cast<PredictFn>(dlsym(handle, "fraud_model_predict"));
+    if (!num_features_fn || !predict_fn) {
+        LOG_WARNING() << "Compiled model " << path << " does not export the model symbols";
+        dlclose(handle);
+        return nullptr;
+    }
+    if (static_cast<size_t>(num_features_fn()) != num_features) {
+        LOG_WARNING() << "Compiled model " << path << " expects " << num_features_fn()
+                      << " features, the model has " << num_features << ", ignoring it";
+        dlclose(handle);
+        return nullptr;
+    }
+    return std::unique_ptr<CompiledTreeModel>(new CompiledTreeModel(handle, predict_fn));
+}
+
+} // namespace fraud_detection
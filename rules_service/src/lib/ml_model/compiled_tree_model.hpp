@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace fraud_detection {
+
+// Tree ensemble compiled ahead of time by tools/compile_tree_model.py into
+// a shared object and loaded with dlopen. Predict takes the same dense
+// feature vector as the XGBoost DMatrix and returns the same probability.
+class CompiledTreeModel {
+public:
+    ~CompiledTreeModel();
+
+    CompiledTreeModel(const CompiledTreeModel&) = delete;
+    CompiledTreeModel& operator=(const CompiledTreeModel&) = delete;
+
+    // nullptr if `path` does not exist, cannot be loaded or was compiled for
+    // a different number of features.
+    static std::unique_ptr<CompiledTreeModel> Load(const std::string& path, size_t num_features);
+
+    double Predict(const float* features) const { return predict_(features); }
+
+private:
+    using PredictFn = double (*)(const float*);
+
+    CompiledTreeModel(void* handle, PredictFn predict) : handle_(handle), predict_(predict) {}
+
+    void* handle_;
+    PredictFn predict_;
+};
+
+} // namespace fraud_detection
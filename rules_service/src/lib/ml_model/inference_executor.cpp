@@ -0,0 +1,59 @@
+#include "inference_executor.hpp"
+
+#include <chrono>
+#include <shared_mutex>
+
+#include <userver/engine/async.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace
+
+InferenceExecutor::InferenceExecutor(userver::engine::TaskProcessor& task_processor, size_t max_pending)
+    : task_processor_(task_processor), slots_(max_pending > 0 ? max_pending : 1) {}
+
+double InferenceExecutor::Run(const std::function<double()>& score) {
+    const auto submitted = std::chrono::steady_clock::now();
+    ++pending_;
+    std::shared_lock slot(slots_);
+
+    auto task = userver::engine::AsyncNoSpan(task_processor_, [this, &score, submitted] {
+        const auto queue_time = MicrosecondsSince(submitted);
+        queue_time_us_ += queue_time;
+        auto max = max_queue_time_us_.load();
+        while (queue_time > max && !max_queue_time_us_.compare_exchange_weak(max, queue_time)) {
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        const double result = score();
+        run_time_us_ += MicrosecondsSince(started);
+        return result;
+    });
+
+    try {
+        const double result = task.Get();
+        --pending_;
+        ++runs_;
+        return result;
+    } catch (...) {
+        --pending_;
+        throw;
+    }
+}
+
+void InferenceExecutor::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    writer["pending"] = pending_.load();
+    writer["runs"] = runs_.load();
+    writer["queue_time_us"] = queue_time_us_.load();
+    writer["max_queue_time_us"] = max_queue_time_us_.load();
+    writer["run_time_us"] = run_time_us_.load();
+}
+
+}  // namespace fraud_detection
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include <userver/engine/semaphore.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+namespace fraud_detection {
+
+// Runs CPU-bound model scoring on a dedicated task processor so that it
+// cannot occupy the main-task-processor threads serving Postgres and Kafka
+// coroutines. At most max_pending scorings are submitted at once; further
+// callers suspend until a slot frees up, which bounds the inference queue.
+class InferenceExecutor {
+public:
+    InferenceExecutor(userver::engine::TaskProcessor& task_processor, size_t max_pending);
+
+    // Runs `score` on the inference task processor and waits for its result.
+    double Run(const std::function<double()>& score);
+
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    userver::engine::TaskProcessor& task_processor_;
+    userver::engine::Semaphore slots_;
+
+    std::atomic<uint64_t> pending_{0};
+    std::atomic<uint64_t> runs_{0};
+    // Totals; divided by runs they give the mean queue and scoring times.
+    std::atomic<uint64_t> queue_time_us_{0};
+    std::atomic<uint64_t> max_queue_time_us_{0};
+    std::atomic<uint64_t> run_time_us_{0};
+};
+
+}  // namespace fraud_detection
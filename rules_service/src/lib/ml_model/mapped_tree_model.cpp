@@ -0,0 +1,123 @@
+#include "mapped_tree_model.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'T', 'M', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kLogistic = 1;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+MappedTreeModel::MappedTreeModel(void* data, size_t size)
+    : data_(data),
+      size_(size),
+      header_(static_cast<const Header*>(data)),
+      roots_(reinterpret_cast<const uint32_t*>(static_cast<const char*>(data) + sizeof(Header))),
+      nodes_(reinterpret_cast<const Node*>(static_cast<const char*>(data) +
+          AlignUp(sizeof(Header) + header_->num_trees * sizeof(uint32_t), sizeof(Node)))) {}
+
+MappedTreeModel::~MappedTreeModel() {
+    munmap(data_, size_);
+}
+
+std::unique_ptr<MappedTreeModel> MappedTreeModel::Load(const std::string& path, size_t num_features) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        LOG_WARNING() << "Mapped model " << path << " is truncated";
+        close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_WARNING() << "Cannot mmap model " << path << ": " << std::strerror(errno);
+        return nullptr;
+    }
+    std::unique_ptr<MappedTreeModel> model(new MappedTreeModel(data, size));
+
+    const auto& header = *model->header_;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        LOG_WARNING() << "Mapped model " << path << " has an unknown format";
+        return nullptr;
+    }
+    const size_t nodes_offset = AlignUp(sizeof(Header) + header.num_trees * sizeof(uint32_t), sizeof(Node));
+    if (nodes_offset + static_cast<size_t>(header.num_nodes) * sizeof(Node) != size) {
+        LOG_WARNING() << "Mapped model " << path << " size does not match its header";
+        return nullptr;
+    }
+    if (header.num_features != num_features) {
+        LOG_WARNING() << "Mapped model " << path << " expects " << header.num_features
+                      << " features, the model has " << num_features << ", ignoring it";
+        return nullptr;
+    }
+    // Node indices are validated once so that Predict can follow them
+    // blindly; children always come after their parent, so walks terminate.
+    for (uint32_t i = 0; i < header.num_trees; ++i) {
+        if (model->roots_[i] >= header.num_nodes) {
+            LOG_WARNING() << "Mapped model " << path << " has an invalid tree root";
+            return nullptr;
+        }
+    }
+    for (uint32_t i = 0; i < header.num_nodes; ++i) {
+        const auto& node = model->nodes_[i];
+        if (node.left != kLeaf &&
+            (node.left <= i || node.right <= i ||
+             node.left >= header.num_nodes || node.right >= header.num_nodes ||
+             (node.feature & ~kDefaultLeft) >= header.num_features)) {
+            LOG_WARNING() << "Mapped model " << path << " has an invalid node " << i;
+            return nullptr;
+        }
+    }
+    madvise(data, size, MADV_WILLNEED);
+    return model;
+}
+
+bool MappedTreeModel::IsMissing(float value) const {
+    return std::isnan(value) || value == header_->missing;
+}
+
+double MappedTreeModel::Predict(const float* features) const {
+    float margin = header_->base_margin;
+    for (uint32_t tree = 0; tree < header_->num_trees; ++tree) {
+        const Node* node = &nodes_[roots_[tree]];
+        while (node->left != kLeaf) {
+            const float value = features[node->feature & ~kDefaultLeft];
+            bool go_left;
+            if (IsMissing(value)) {
+                go_left = (node->feature & kDefaultLeft) != 0;
+            } else {
+                go_left = value < node->value;
+            }
+            node = &nodes_[go_left ? node->left : node->right];
+        }
+        margin += node->value;
+    }
+    if (header_->transform == kLogistic) {
+        return 1.0f / (1.0f + std::exp(-margin));
+    }
+    return margin;
+}
+
+} // namespace fraud_detection
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace fraud_detection {
+
+// Read-only tree ensemble in the <uuid>_trees.bin format written by
+// tools/compile_tree_model.py --binary. The file is mapped with mmap and
+// walked in place: loading costs a few page faults instead of parsing the
+// JSON model, and every process on the host shares the same page cache.
+class MappedTreeModel {
+public:
+    ~MappedTreeModel();
+
+    MappedTreeModel(const MappedTreeModel&) = delete;
+    MappedTreeModel& operator=(const MappedTreeModel&) = delete;
+
+    // nullptr if `path` does not exist, is malformed or was built for a
+    // different number of features.
+    static std::unique_ptr<MappedTreeModel> Load(const std::string& path, size_t num_features);
+
+    // Same semantics as XGBoost on a DMatrix with the file's missing value.
+    double Predict(const float* features) const;
+
+    size_t MappedBytes() const { return size_; }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t num_features;
+        uint32_t num_trees;
+        uint32_t num_nodes;
+        uint32_t transform;
+        float base_margin;
+        float missing;
+    };
+
+    struct Node {
+        float value;
+        uint32_t feature;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    static constexpr uint32_t kLeaf = 0xFFFFFFFF;
+    static constexpr uint32_t kDefaultLeft = 0x80000000;
+
+    MappedTreeModel(void* data, size_t size);
+
+    bool IsMissing(float value) const;
+
+    void* data_;
+    size_t size_;
+    const Header* header_;
+    const uint32_t* roots_;
+    const Node* nodes_;
+};
+
+} // namespace fraud_detection
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <iomanip>
 #include <stdexcept>
 
@@ -48,8 +49,43 @@ std::time_t ParseIsoToEpochSeconds(const std::string& iso) {
     }
 }
 
+int64_t ParseTimestampString(const std::string& timestamp_str) {
+    std::string t = Trim(timestamp_str);
+    if (t.empty()) return 0;
+    
+    if (t.find('T') != std::string::npos) {
+        return static_cast<int64_t>(ParseIsoToEpochSeconds(t));
+    }
+    
+    try {
+        return std::stoll(t);
+    } catch (...) {
+        return static_cast<int64_t>(ParseIsoToEpochSeconds(t));
+    }
+}
+
+// Column suffix of a half-life: 3600 -> "1h", 2592000 -> "30d".
+std::string HalfLifeSuffix(int64_t seconds) {
+    if (seconds > 0 && seconds % 86400 == 0) return std::to_string(seconds / 86400) + "d";
+    if (seconds > 0 && seconds % 3600 == 0) return std::to_string(seconds / 3600) + "h";
+    if (seconds > 0 && seconds % 60 == 0) return std::to_string(seconds / 60) + "m";
+    return std::to_string(seconds) + "s";
+}
+
 } // anonymous namespace
 
+HistoryColumns TransactionHistoryProvider::GetAccountHistoryColumns(
+    const std::string& account_id,
+    int64_t before_timestamp) {
+    const auto history = GetAccountHistory(account_id, before_timestamp);
+    HistoryColumns columns;
+    columns.Reserve(history.size());
+    for (const auto& txn : history) {
+        columns.Append(ParseTimestampString(txn.timestamp()), static_cast<float>(txn.amount()), txn.location());
+    }
+    return columns;
+}
+
 MLFraudDetector::MLFraudDetector() = default;
 
 MLFraudDetector::~MLFraudDetector() {
@@ -64,10 +100,16 @@ MLFraudDetector::~MLFraudDetector() {
 }
 
 
-bool MLFraudDetector::LoadModelByUuid(const std::string& config_dir, const std::string& uuid) {
+bool MLFraudDetector::LoadModelByUuid(
+    const std::string& config_dir,
+    const std::string& uuid,
+    const std::string& artifact_dir) {
     config_dir_ = config_dir;
     feature_names_.clear();
     feature_index_map_.clear();
+    gate_threshold_.reset();
+    compiled_model_.reset();
+    mapped_model_.reset();
     if (xgb_model_) {
         XGBoosterFree(xgb_model_);
         xgb_model_ = nullptr;
@@ -115,6 +157,18 @@ bool MLFraudDetector::LoadModelByUuid(const std::string& config_dir, const std::
     } else {
         LOG_INFO() << "LightGBM model not found (optional) for uuid " << uuid << ", skipping";
     }
+
+    if (lgbm_model_) {
+        std::string gate_path = config_dir + "/" + uuid + "_gate.txt";
+        std::ifstream gate_file(gate_path);
+        double gate = 0.0;
+        if (gate_file >> gate) {
+            gate_threshold_ = gate;
+            LOG_INFO() << "Stage2 of uuid " << uuid << " gated at stage1 score " << gate;
+        } else if (gate_file.is_open()) {
+            LOG_WARNING() << "Invalid gate threshold in " << gate_path << ", stage2 runs for every transaction";
+        }
+    }
 #endif
 
     std::string xgb_path = config_dir + "/" + uuid + "_json.json";
@@ -124,6 +178,38 @@ bool MLFraudDetector::LoadModelByUuid(const std::string& config_dir, const std::
         return false;
     }
     xgb_check.close();
+
+    // Artefacts built from the JSON model are used only while they are not
+    // older than it, i.e. the model has not been retrained since.
+    std::error_code ec;
+    const auto xgb_mtime = std::filesystem::last_write_time(xgb_path, ec);
+    auto is_current = [&](const std::string& path) {
+        std::error_code artefact_ec;
+        if (!std::filesystem::exists(path, artefact_ec)) {
+            return false;
+        }
+        if (!ec && std::filesystem::last_write_time(path, artefact_ec) < xgb_mtime) {
+            LOG_WARNING() << path << " is older than " << xgb_path << ", ignoring it";
+            return false;
+        }
+        return true;
+    };
+
+    const std::string& artifact_prefix = artifact_dir.empty() ? config_dir : artifact_dir;
+    std::string compiled_path = artifact_prefix + "/" + uuid + "_compiled.so";
+    if (is_current(compiled_path) &&
+        (compiled_model_ = CompiledTreeModel::Load(compiled_path, feature_names_.size()))) {
+        LOG_INFO() << "Loaded compiled model from " << compiled_path << " for uuid " << uuid;
+        return true;
+    }
+    std::string mapped_path = artifact_prefix + "/" + uuid + "_trees.bin";
+    if (is_current(mapped_path) &&
+        (mapped_model_ = MappedTreeModel::Load(mapped_path, feature_names_.size()))) {
+        LOG_INFO() << "Mapped " << mapped_model_->MappedBytes() << " bytes of model " << mapped_path
+                   << " for uuid " << uuid;
+        return true;
+    }
+
     if (XGBoosterCreate(nullptr, 0, &xgb_model_) != 0) {
         LOG_ERROR() << "XGBoosterCreate failed";
         return false;
@@ -134,23 +220,16 @@ bool MLFraudDetector::LoadModelByUuid(const std::string& config_dir, const std::
         xgb_model_ = nullptr;
         return false;
     }
+    // Scoring runs one row at a time on the inference task processor, whose
+    // workers are the parallelism; XGBoost's own thread pool would only
+    // oversubscribe the cores.
+    XGBoosterSetParam(xgb_model_, "nthread", "1");
     LOG_INFO() << "Loaded XGBoost model from " << xgb_path << " for uuid " << uuid;
     return true;
 }
 
-int64_t MLFraudDetector::ParseTimestamp(const std::string& timestamp_str) {
-    std::string t = Trim(timestamp_str);
-    if (t.empty()) return 0;
-    
-    if (t.find('T') != std::string::npos) {
-        return static_cast<int64_t>(ParseIsoToEpochSeconds(t));
-    }
-    
-    try {
-        return std::stoll(t);
-    } catch (...) {
-        return static_cast<int64_t>(ParseIsoToEpochSeconds(t));
-    }
+int64_t MLFraudDetector::ParseTimestamp(const std::string& timestamp_str) const {
+    return ParseTimestampString(timestamp_str);
 }
 
 AccountStats MLFraudDetector::ComputeAccountStats(
@@ -162,9 +241,9 @@ AccountStats MLFraudDetector::ComputeAccountStats(
     
     AccountStats out;
     
-    auto history = provider.GetAccountHistory(account_id, current_ts);
+    const auto history = provider.GetAccountHistoryColumns(account_id, current_ts);
     
-    if (history.empty()) {
+    if (history.Empty()) {
         LOG_DEBUG() << "No history for account " << account_id;
         return out;
     }
@@ -173,15 +252,13 @@ AccountStats MLFraudDetector::ComputeAccountStats(
     double mean = 0.0, m2 = 0.0;
     int64_t last_before = 0;
     int64_t cnt_window = 0;
-    std::unordered_map<std::string, int64_t> loc_counts;
-    int64_t total_count = 0;
     const int64_t window_start = current_ts - 86400;
     
-    for (const auto& txn : history) {
-        int64_t ts = ParseTimestamp(txn.timestamp());
-        double amt = txn.amount();
+    for (size_t i = 0; i < history.Size(); ++i) {
+        int64_t ts = history.timestamps[i];
+        double amt = history.amounts[i];
         
-        double amt_log = std::log1p(std::max(0.0, static_cast<double>(amt)));
+        double amt_log = std::log1p(std::max(0.0, amt));
         
         n += 1;
         double delta = amt_log - mean;
@@ -195,11 +272,8 @@ AccountStats MLFraudDetector::ComputeAccountStats(
         if (ts >= window_start && ts < current_ts) {
             cnt_window++;
         }
-        
-        std::string loc = txn.location();
-        loc_counts[loc] += 1;
-        total_count++;
     }
+    const int64_t total_count = static_cast<int64_t>(history.Size());
     
     out.time_since_last_transaction = (last_before > 0) 
         ? static_cast<double>(current_ts - last_before) 
@@ -218,9 +292,8 @@ AccountStats MLFraudDetector::ComputeAccountStats(
     out.velocity_score = static_cast<double>(cnt_window);
     
     int64_t loc_cnt = 0;
-    auto it = loc_counts.find(current_location);
-    if (it != loc_counts.end()) {
-        loc_cnt = it->second;
+    if (const auto location_id = history.FindLocation(current_location)) {
+        loc_cnt = std::count(history.location_ids.begin(), history.location_ids.end(), *location_id);
     }
     
     if (total_count <= 0) {
@@ -244,7 +317,8 @@ float MLFraudDetector::SafeFloat(double v) {
 
 std::vector<float> MLFraudDetector::CreateFeatureVector(
     const transaction::Transaction& txn,
-    const AccountStats& stats) {
+    const AccountStats& stats,
+    const std::vector<DecayedFeatures>& decayed) const {
     
     std::vector<float> vec(feature_names_.size(), 0.0f);
     
@@ -261,6 +335,17 @@ std::vector<float> MLFraudDetector::CreateFeatureVector(
     set_feature("spending_deviation_score", stats.spending_deviation_score);
     set_feature("velocity_score", stats.velocity_score);
     set_feature("geo_anomaly_score", stats.geo_anomaly_score);
+
+    for (const auto& features : decayed) {
+        const auto suffix = HalfLifeSuffix(features.half_life);
+        set_feature("decayed_rate_" + suffix, features.rate);
+        set_feature("decayed_amount_mean_" + suffix, features.amount_mean);
+        set_feature("decayed_amount_std_" + suffix, features.amount_std);
+        set_feature("decayed_spending_deviation_" + suffix, features.log_amount_std > 1e-12
+            ? (amount_trans - features.log_amount_mean) / features.log_amount_std
+            : 0.0);
+        set_feature("decayed_location_frequency_" + suffix, features.location_frequency);
+    }
     
     int64_t timestamp = ParseTimestamp(txn.timestamp());
     std::time_t t = static_cast<std::time_t>(timestamp);
@@ -358,9 +443,10 @@ std::vector<float> MLFraudDetector::CreateFeatureVector(
 
 double MLFraudDetector::PredictFraudProbability(
     const transaction::Transaction& txn,
-    TransactionHistoryProvider& provider) {
+    TransactionHistoryProvider& provider,
+    const std::vector<DecayedFeatures>& decayed) {
     
-    if (!xgb_model_) {
+    if (!IsLoaded()) {
         throw std::runtime_error("XGBoost model not loaded");
     }
     
@@ -369,8 +455,45 @@ double MLFraudDetector::PredictFraudProbability(
     double amount = static_cast<double>(txn.amount());
     std::string location = txn.location();
     
-    AccountStats stats = ComputeAccountStats(sender, timestamp, amount, location, provider);
-    
+    AccountStatsKey stats_key{sender, timestamp, amount, location};
+    AccountStats stats;
+    if (auto cached = provider.FindAccountStats(stats_key)) {
+        stats = *cached;
+    } else {
+        stats = ComputeAccountStats(sender, timestamp, amount, location, provider);
+        provider.StoreAccountStats(stats_key, stats);
+    }
+
+    if (!inference_executor_) {
+        return Score(txn, stats, decayed, timestamp);
+    }
+    return inference_executor_->Run([&] { return Score(txn, stats, decayed, timestamp); });
+}
+
+double MLFraudDetector::Score(
+    const transaction::Transaction& txn,
+    const AccountStats& stats,
+    const std::vector<DecayedFeatures>& decayed,
+    int64_t timestamp) const {
+    const auto stage1_score = ScoreStage1(stats, static_cast<double>(txn.amount()), timestamp);
+    if (stage1_score && gate_threshold_) {
+        if (*stage1_score < *gate_threshold_) {
+            ++gate_skipped_;
+            LOG_DEBUG() << "LightGBM stage1 score " << *stage1_score << " for txn "
+                        << txn.transaction_id() << " is below gate " << *gate_threshold_;
+            return 0.0;
+        }
+        ++gate_passed_;
+    } else {
+        ++ungated_;
+    }
+    return ScoreStage2(txn, stats, decayed);
+}
+
+std::optional<double> MLFraudDetector::ScoreStage1(
+    [[maybe_unused]] const AccountStats& stats,
+    [[maybe_unused]] double amount,
+    [[maybe_unused]] int64_t timestamp) const {
 #ifdef HAVE_LIGHTGBM
     if (lgbm_model_) {
         std::vector<double> lgbm_feats;
@@ -396,13 +519,34 @@ double MLFraudDetector::PredictFraudProbability(
         int64_t out_len = 0;
         if (LGBM_BoosterPredictForMat(lgbm_model_, lgbm_feats.data(), C_API_DTYPE_FLOAT64, 
                                      1, static_cast<int>(lgbm_feats.size()), 1,
-                                     C_API_PREDICT_NORMAL, 0, -1, "", &out_len, &lgbm_score) == 0) {
+                                     C_API_PREDICT_NORMAL, 0, -1, "num_threads=1", &out_len, &lgbm_score) == 0) {
             LOG_DEBUG() << "LightGBM stage1 score: " << lgbm_score;
+            return lgbm_score;
         }
+        LOG_WARNING() << "LightGBM stage1 prediction failed, falling back to stage2";
     }
 #endif
-    
-    std::vector<float> xgb_input = CreateFeatureVector(txn, stats);
+    return std::nullopt;
+}
+
+double MLFraudDetector::ScoreStage2(
+    const transaction::Transaction& txn,
+    const AccountStats& stats,
+    const std::vector<DecayedFeatures>& decayed) const {
+    std::vector<float> xgb_input = CreateFeatureVector(txn, stats, decayed);
+
+    if (compiled_model_) {
+        const double score = compiled_model_->Predict(xgb_input.data());
+        LOG_INFO() << "Compiled fraud probability for txn " << txn.transaction_id()
+                   << ": " << score;
+        return score;
+    }
+    if (mapped_model_) {
+        const double score = mapped_model_->Predict(xgb_input.data());
+        LOG_INFO() << "Mapped model fraud probability for txn " << txn.transaction_id()
+                   << ": " << score;
+        return score;
+    }
     
     DMatrixHandle dmat;
     if (XGDMatrixCreateFromMat(xgb_input.data(), 1, 
@@ -427,4 +571,17 @@ double MLFraudDetector::PredictFraudProbability(
     return static_cast<double>(score);
 }
 
+void MLFraudDetector::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    const auto passed = gate_passed_.load();
+    const auto skipped = gate_skipped_.load();
+    writer["gate_passed"] = passed;
+    writer["gate_skipped"] = skipped;
+    writer["ungated"] = ungated_.load();
+    writer["compiled"] = compiled_model_ ? 1 : 0;
+    writer["mapped"] = mapped_model_ ? 1 : 0;
+    if (passed + skipped > 0) {
+        writer["gate_skip_ratio"] = static_cast<double>(skipped) / static_cast<double>(passed + skipped);
+    }
+}
+
 } // namespace fraud_detection
@@ -2,10 +2,19 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 
 #include <transaction/transaction.pb.h>
+#include <userver/utils/statistics/writer.hpp>
+
+#include "account_state/decayed_stats.hpp"
+#include "transaction_history/history_columns.hpp"
+#include "compiled_tree_model.hpp"
+#include "inference_executor.hpp"
+#include "mapped_tree_model.hpp"
 
 typedef void* BoosterHandle;
 typedef void* DMatrixHandle;
@@ -19,6 +28,17 @@ struct AccountStats {
     double geo_anomaly_score = 1.0;
 };
 
+// Inputs AccountStats are derived from, identical for every model that
+// scores the same transaction.
+struct AccountStatsKey {
+    std::string account_id;
+    int64_t timestamp = 0;
+    double amount = 0.0;
+    std::string location;
+
+    bool operator==(const AccountStatsKey&) const = default;
+};
+
 class TransactionHistoryProvider {
 public:
     virtual ~TransactionHistoryProvider() = default;
@@ -26,6 +46,17 @@ public:
     virtual std::vector<transaction::Transaction> GetAccountHistory(
         const std::string& account_id,
         int64_t before_timestamp) = 0;
+
+    // The same history as timestamp / amount / location columns, which is
+    // all ComputeAccountStats reads. The default converts GetAccountHistory.
+    virtual HistoryColumns GetAccountHistoryColumns(
+        const std::string& account_id,
+        int64_t before_timestamp);
+
+    // Request-scoped providers memoize the stats computed from their
+    // history; by default they are recomputed for every prediction.
+    virtual std::optional<AccountStats> FindAccountStats(const AccountStatsKey&) { return std::nullopt; }
+    virtual void StoreAccountStats(const AccountStatsKey&, const AccountStats&) {}
 };
 
 class MLFraudDetector {
@@ -33,18 +64,42 @@ public:
     MLFraudDetector();
     ~MLFraudDetector();
 
-    bool LoadModelByUuid(const std::string& config_dir, const std::string& uuid);
-
+    // The compiled and mapped forms of the model are looked up in
+    // artifact_dir, by default next to the model files in config_dir.
+    bool LoadModelByUuid(
+        const std::string& config_dir,
+        const std::string& uuid,
+        const std::string& artifact_dir = {});
+
+    // `decayed` are the sender's decayed features, filling the
+    // decayed_<feature>_<half-life> columns (e.g. decayed_rate_1h) a model
+    // may list; such columns stay 0 when it is empty.
+    // With a <uuid>_gate.txt threshold next to the LightGBM model, a stage 1
+    // score below it skips XGBoost and scores 0: stage 1 alone never decides
+    // FRAUD, whatever threshold the rule uses.
     double PredictFraudProbability(
         const transaction::Transaction& txn,
-        TransactionHistoryProvider& provider);
+        TransactionHistoryProvider& provider,
+        const std::vector<DecayedFeatures>& decayed = {});
 
 
-    bool IsLoaded() const { return xgb_model_ != nullptr; }
+    bool IsLoaded() const { return compiled_model_ || mapped_model_ || xgb_model_ != nullptr; }
 
 
     std::string GetVersion() const { return config_dir_; }
 
+    // Stage 1 gate decisions: gate_passed / gate_skipped, their skip ratio
+    // and ungated predictions that went straight to stage 2; `compiled` and
+    // `mapped` tell which stage 2 backend is in use.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+    // Routes model scoring to the executor's task processor; history
+    // lookups stay on the calling coroutine. Without an executor scoring
+    // runs inline.
+    void SetInferenceExecutor(std::shared_ptr<InferenceExecutor> executor) {
+        inference_executor_ = std::move(executor);
+    }
+
 private:
 
     AccountStats ComputeAccountStats(
@@ -56,10 +111,34 @@ private:
 
     std::vector<float> CreateFeatureVector(
         const transaction::Transaction& txn,
-        const AccountStats& stats);
+        const AccountStats& stats,
+        const std::vector<DecayedFeatures>& decayed) const;
+
+    // CPU-bound part of PredictFraudProbability: LightGBM stage 1 and the
+    // XGBoost prediction.
+    double Score(
+        const transaction::Transaction& txn,
+        const AccountStats& stats,
+        const std::vector<DecayedFeatures>& decayed,
+        int64_t timestamp) const;
+
+    // LightGBM on the 12 basic features; nullopt without a stage 1 model.
+    std::optional<double> ScoreStage1(
+        const AccountStats& stats,
+        double amount,
+        int64_t timestamp) const;
+
+    // XGBoost on the full feature vector. Backends built from the current
+    // JSON model are preferred in order: <uuid>_compiled.so, the mmap-ed
+    // <uuid>_trees.bin, and only then the XGBoost runtime, which is not
+    // loaded at all when one of the former is.
+    double ScoreStage2(
+        const transaction::Transaction& txn,
+        const AccountStats& stats,
+        const std::vector<DecayedFeatures>& decayed) const;
 
 
-    int64_t ParseTimestamp(const std::string& timestamp_str);
+    int64_t ParseTimestamp(const std::string& timestamp_str) const;
 
 
     static float SafeFloat(double value);
@@ -67,11 +146,20 @@ private:
 
     BoosterHandle lgbm_model_ = nullptr;
     BoosterHandle xgb_model_ = nullptr;
+    std::unique_ptr<CompiledTreeModel> compiled_model_;
+    std::unique_ptr<MappedTreeModel> mapped_model_;
     
     
     std::string config_dir_;
     std::vector<std::string> feature_names_;
     std::unordered_map<std::string, int> feature_index_map_;
+
+    std::shared_ptr<InferenceExecutor> inference_executor_;
+
+    std::optional<double> gate_threshold_;
+    mutable std::atomic<uint64_t> gate_passed_{0};
+    mutable std::atomic<uint64_t> gate_skipped_{0};
+    mutable std::atomic<uint64_t> ungated_{0};
 };
 
 } // namespace fraud_detection
@@ -0,0 +1,123 @@
+#include "model_registry.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+
+#include <userver/engine/async.hpp>
+#include <userver/engine/task/task_with_result.hpp>
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+constexpr std::string_view kColumnsSuffix = "_columns.txt";
+constexpr std::string_view kXgbSuffix = "_json.json";
+
+} // anonymous namespace
+
+MLModelRegistry::MLModelRegistry(
+    std::string config_dir,
+    std::shared_ptr<InferenceExecutor> executor,
+    std::string artifact_dir)
+    : config_dir_(std::move(config_dir)),
+      artifact_dir_(std::move(artifact_dir)),
+      executor_(std::move(executor)) {}
+
+std::vector<std::string> MLModelRegistry::DiscoverModelUuids() const {
+    std::vector<std::string> uuids;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(config_dir_, ec)) {
+        const auto name = entry.path().filename().string();
+        if (name.size() <= kColumnsSuffix.size() ||
+            name.compare(name.size() - kColumnsSuffix.size(), kColumnsSuffix.size(), kColumnsSuffix) != 0) {
+            continue;
+        }
+        auto uuid = name.substr(0, name.size() - kColumnsSuffix.size());
+        if (std::filesystem::exists(config_dir_ + "/" + uuid + std::string(kXgbSuffix), ec)) {
+            uuids.push_back(std::move(uuid));
+        }
+    }
+    if (ec) {
+        LOG_WARNING() << "Cannot list model config dir " << config_dir_ << ": " << ec.message();
+    }
+    return uuids;
+}
+
+size_t MLModelRegistry::LoadAll(userver::engine::TaskProcessor& task_processor) {
+    const auto uuids = DiscoverModelUuids();
+
+    std::vector<userver::engine::TaskWithResult<std::shared_ptr<MLFraudDetector>>> tasks;
+    tasks.reserve(uuids.size());
+    for (const auto& uuid : uuids) {
+        tasks.push_back(userver::engine::AsyncNoSpan(task_processor, [this, uuid] {
+            return Load(uuid);
+        }));
+    }
+
+    size_t loaded = 0;
+    for (size_t i = 0; i < uuids.size(); ++i) {
+        auto detector = tasks[i].Get();
+        if (!detector) continue;
+        std::lock_guard lock(mutex_);
+        models_[uuids[i]] = std::move(detector);
+        ++loaded;
+    }
+    LOG_INFO() << "Preloaded " << loaded << " of " << uuids.size() << " models from " << config_dir_;
+    return loaded;
+}
+
+std::shared_ptr<MLFraudDetector> MLModelRegistry::Get(const std::string& uuid) {
+    {
+        std::shared_lock lock(mutex_);
+        auto it = models_.find(uuid);
+        if (it != models_.end()) {
+            return it->second;
+        }
+        auto failed = failed_until_.find(uuid);
+        if (failed != failed_until_.end() && std::chrono::steady_clock::now() < failed->second) {
+            return nullptr;
+        }
+    }
+
+    auto detector = Load(uuid);
+    std::lock_guard lock(mutex_);
+    if (!detector) {
+        failed_until_[uuid] = std::chrono::steady_clock::now() + kFailedLoadRetry;
+        return nullptr;
+    }
+    failed_until_.erase(uuid);
+    auto [it, inserted] = models_.try_emplace(uuid, std::move(detector));
+    return it->second;
+}
+
+std::vector<std::string> MLModelRegistry::GetLoadedUuids() const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::string> uuids;
+    uuids.reserve(models_.size());
+    for (const auto& [uuid, detector] : models_) {
+        uuids.push_back(uuid);
+    }
+    return uuids;
+}
+
+void MLModelRegistry::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    std::shared_lock lock(mutex_);
+    for (const auto& [uuid, detector] : models_) {
+        auto model_writer = writer[uuid];
+        detector->WriteStatistics(model_writer);
+    }
+}
+
+std::shared_ptr<MLFraudDetector> MLModelRegistry::Load(const std::string& uuid) const {
+    auto detector = std::make_shared<MLFraudDetector>();
+    if (!detector->LoadModelByUuid(config_dir_, uuid, artifact_dir_)) {
+        LOG_ERROR() << "Failed to load model " << uuid << " from " << config_dir_;
+        return nullptr;
+    }
+    detector->SetInferenceExecutor(executor_);
+    return detector;
+}
+
+} // namespace fraud_detection
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <userver/engine/shared_mutex.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+
+#include "ml_fraud_detector.hpp"
+
+namespace fraud_detection {
+
+// Loaded models by uuid. Every model is loaded once into its own detector
+// and then shared read-only by all coroutines evaluating ML rules.
+class MLModelRegistry {
+public:
+    // Every loaded model scores through `executor` when it is set. Compiled
+    // model artefacts are read from artifact_dir, by default config_dir.
+    explicit MLModelRegistry(
+        std::string config_dir,
+        std::shared_ptr<InferenceExecutor> executor = nullptr,
+        std::string artifact_dir = {});
+
+    // uuids of all models in the config directory, i.e. every
+    // <uuid>_columns.txt that has a matching <uuid>_json.json.
+    std::vector<std::string> DiscoverModelUuids() const;
+
+    // Loads all discovered models in parallel on the given task processor.
+    // Returns the number of successfully loaded models.
+    size_t LoadAll(userver::engine::TaskProcessor& task_processor);
+
+    // Returns the loaded model, loading it on first use. nullptr if the model
+    // files are missing or broken; such a uuid is not looked up on disk again
+    // for kFailedLoadRetry.
+    std::shared_ptr<MLFraudDetector> Get(const std::string& uuid);
+
+    std::vector<std::string> GetLoadedUuids() const;
+
+    const std::string& GetConfigDir() const { return config_dir_; }
+
+    // Per-model statistics, one section per loaded uuid.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+    static constexpr std::chrono::seconds kFailedLoadRetry{30};
+
+private:
+    std::shared_ptr<MLFraudDetector> Load(const std::string& uuid) const;
+
+    const std::string config_dir_;
+    const std::string artifact_dir_;
+    const std::shared_ptr<InferenceExecutor> executor_;
+
+    mutable userver::engine::SharedMutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<MLFraudDetector>> models_;
+    // When a uuid whose load failed may be retried.
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> failed_until_;
+};
+
+} // namespace fraud_detection
@@ -60,4 +60,14 @@ std::vector<transaction::Transaction> RedisHistoryProvider::GetAccountHistory(
     return filtered;
 }
 
+HistoryColumns RedisHistoryProvider::GetAccountHistoryColumns(
+    const std::string& account_id,
+    int64_t before_timestamp) {
+    if (!history_service_) {
+        LOG_WARNING() << "TransactionHistoryService not available";
+        return {};
+    }
+    return history_service_->GetAccountHistoryColumns(account_id, before_timestamp, 1000);
+}
+
 } // namespace fraud_detection
@@ -16,6 +16,11 @@ public:
         const std::string& account_id,
         int64_t before_timestamp) override;
 
+    // Projected query: only timestamp, amount and location are fetched.
+    HistoryColumns GetAccountHistoryColumns(
+        const std::string& account_id,
+        int64_t before_timestamp) override;
+
 private:
     std::shared_ptr<TransactionHistoryService> history_service_;
 };
@@ -6,10 +6,12 @@ namespace fraud_detection {
 
 MlRuleAnalyzer::MlRuleAnalyzer(const rules::RuleConfig& rule_config,
                                std::shared_ptr<MLFraudDetector> ml_detector,
-                               std::shared_ptr<TransactionHistoryProvider> history_provider)
+                               std::shared_ptr<TransactionHistoryProvider> history_provider,
+                               std::shared_ptr<AccountStateStore> state_store)
     : rule_config_(rule_config)
     , ml_detector_(std::move(ml_detector))
     , history_provider_(std::move(history_provider))
+    , state_store_(std::move(state_store))
     , threshold_(0.5) {
     
     if (rule_config_.has_ml_rule()) {
@@ -35,7 +37,16 @@ bool MlRuleAnalyzer::IsFraudTransaction(const transaction::Transaction& transact
     }
     
     try {
-        double fraud_probability = ml_detector_->PredictFraudProbability(transaction, *history_provider_);
+        std::vector<DecayedFeatures> decayed;
+        if (state_store_) {
+            decayed = state_store_->GetDecayedFeatures(
+                transaction.sender_account(), std::stoll(transaction.timestamp()), transaction.location());
+        }
+        // Inside RuleProcessor the transaction's request cache shares the
+        // history fetch and account stats with the other ML rules.
+        auto* request_history = CachedHistoryProvider::Current();
+        double fraud_probability = ml_detector_->PredictFraudProbability(
+            transaction, request_history ? *request_history : *history_provider_, decayed);
         
         bool is_fraud = fraud_probability >= threshold_;
         
@@ -3,6 +3,8 @@
 #include "rule_interface/IRule.hpp"
 #include "ml_model/ml_fraud_detector.hpp"
 #include "ml_model/redis_history_provider.hpp"
+#include "ml_model/cached_history_provider.hpp"
+#include "account_state/account_state_store.hpp"
 #include <rules/rule_config.pb.h>
 #include <memory>
 
@@ -12,7 +14,8 @@ class MlRuleAnalyzer : public IRule {
 public:
     MlRuleAnalyzer(const rules::RuleConfig& rule_config,
                    std::shared_ptr<MLFraudDetector> ml_detector,
-                   std::shared_ptr<TransactionHistoryProvider> history_provider);
+                   std::shared_ptr<TransactionHistoryProvider> history_provider,
+                   std::shared_ptr<AccountStateStore> state_store = nullptr);
 
     bool IsFraudTransaction(const transaction::Transaction& transaction) const override;
 
@@ -20,6 +23,7 @@ private:
     const rules::RuleConfig rule_config_;
     std::shared_ptr<MLFraudDetector> ml_detector_;
     std::shared_ptr<TransactionHistoryProvider> history_provider_;
+    std::shared_ptr<AccountStateStore> state_store_;
     double threshold_;
 };
 
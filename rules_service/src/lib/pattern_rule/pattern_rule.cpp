@@ -4,14 +4,76 @@
 #include <limits>
 #include <cmath>
 #include <algorithm>
+#include <functional>
+#include <sstream>
 
 namespace fraud_detection {
 
+namespace {
+
+std::optional<WindowField> ToWindowField(rules::FieldReference::FieldType field) {
+    switch (field) {
+        case rules::FieldReference::SENDER_ACCOUNT: return WindowField::kSenderAccount;
+        case rules::FieldReference::RECEIVER_ACCOUNT: return WindowField::kReceiverAccount;
+        case rules::FieldReference::MERCHANT_CATEGORY: return WindowField::kMerchantCategory;
+        case rules::FieldReference::LOCATION: return WindowField::kLocation;
+        case rules::FieldReference::IP_ADDRESS: return WindowField::kIpAddress;
+        case rules::FieldReference::DEVICE_HASH: return WindowField::kDeviceHash;
+        default: return std::nullopt;
+    }
+}
+
+}  // namespace
+
 PatternRuleAnalyzer::PatternRuleAnalyzer(
     const rules::RuleConfig& rule_config,
-    std::shared_ptr<TransactionHistoryService> history_service)
+    std::shared_ptr<TransactionHistoryService> history_service,
+    std::shared_ptr<AccountStateStore> state_store,
+    std::shared_ptr<KeyedWindowStore> window_store)
     : rule_config_(rule_config)
-    , history_service_(std::move(history_service)) {}
+    , history_service_(std::move(history_service))
+    , state_store_(std::move(state_store))
+    , window_store_(std::move(window_store)) {
+    if (rule_config_.has_pattern_rule()) {
+        max_delta_time_ = rule_config_.pattern_rule().max_delta_time();
+        max_count_ = rule_config_.pattern_rule().max_count();
+        distinct_precision_ = std::clamp<int32_t>(
+            rule_config_.pattern_rule().distinct_precision(), 0, HyperLogLog::kMaxPrecision);
+        if (distinct_precision_ > 0) {
+            distinct_precision_ = std::max<int32_t>(distinct_precision_, HyperLogLog::kMinPrecision);
+        }
+        CompileAggregates(rule_config_.pattern_rule().expression());
+        planner_ = std::make_unique<rule_utils::EvaluationPlanner>(
+            rule_config_.pattern_rule().expression(),
+            [this](const rules::Expression& expr) { return ValueCost(expr); });
+    }
+}
+
+double PatternRuleAnalyzer::ValueCost(const rules::Expression& expr) const {
+    using Planner = rule_utils::EvaluationPlanner;
+    switch (expr.expr_case()) {
+        case rules::Expression::kLiteral:
+            return Planner::kLiteralCost;
+        case rules::Expression::kAggregate: {
+            auto it = aggregates_.find(&expr.aggregate());
+            if (it == aggregates_.end()) {
+                return Planner::kSqlAggregateCost;
+            }
+            const auto& compiled = it->second;
+            const bool in_memory = compiled.sketch_field || compiled.use_amount_digest ||
+                                   compiled.decayed_index || compiled.window_function;
+            return in_memory ? Planner::kMemoryAggregateCost : Planner::kSqlAggregateCost;
+        }
+        default:
+            return Planner::kFieldCost;
+    }
+}
+
+void PatternRuleAnalyzer::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    if (planner_) {
+        planner_->WriteStatistics(writer);
+    }
+}
 
 bool PatternRuleAnalyzer::IsFraudTransaction(const transaction::Transaction& transaction) const {
     if (!rule_config_.has_pattern_rule()) {
@@ -80,20 +142,10 @@ bool PatternRuleAnalyzer::EvaluateLogical(
     
     switch (logical.operator_()) {
         case rules::LogicalOperation::AND:
-            for (const auto& operand : logical.operands()) {
-                if (!EvaluateExpression(transaction, operand)) {
-                    return false;
-                }
-            }
-            return true;
-        
         case rules::LogicalOperation::OR:
-            for (const auto& operand : logical.operands()) {
-                if (EvaluateExpression(transaction, operand)) {
-                    return true;
-                }
-            }
-            return false;
+            return planner_->Evaluate(logical, [&](const rules::Expression& operand) {
+                return EvaluateExpression(transaction, operand);
+            });
         
         case rules::LogicalOperation::NOT:
             if (logical.operands_size() != 1) {
@@ -107,33 +159,132 @@ bool PatternRuleAnalyzer::EvaluateLogical(
 }
 
 
-rule_utils::ExpressionValue PatternRuleAnalyzer::EvaluateAggregate(
-    const transaction::Transaction& transaction,
+template <typename Estimate>
+std::optional<double> PatternRuleAnalyzer::EstimateFromSketches(
+    const std::string& account_id,
+    int64_t since,
+    const Estimate& estimate) const {
+    if (!state_store_) {
+        return std::nullopt;
+    }
+    if (auto result = estimate()) {
+        return result;
+    }
+    // The sketches start with the first transaction this replica applied;
+    // load the older part of the window once and keep it in the sketches.
+    // Accounts of other replicas go straight to the SQL aggregate.
+    if (!history_service_ || !state_store_->ClaimBackfill(account_id, since)) {
+        return std::nullopt;
+    }
+    auto history = history_service_->GetTransactionsSince(account_id, since);
+    if (!history || !state_store_->BackfillSketches(account_id, *history, since)) {
+        return std::nullopt;
+    }
+    return estimate();
+}
+
+void PatternRuleAnalyzer::CompileAggregates(const rules::Expression& expr) {
+    switch (expr.expr_case()) {
+        case rules::Expression::kAggregate:
+            aggregates_.emplace(&expr.aggregate(), CompileAggregate(expr.aggregate()));
+            CompileAggregates(expr.aggregate().operand());
+            break;
+        case rules::Expression::kComparison:
+            CompileAggregates(expr.comparison().left());
+            CompileAggregates(expr.comparison().right());
+            break;
+        case rules::Expression::kLogical:
+            for (const auto& operand : expr.logical().operands()) {
+                CompileAggregates(operand);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+PatternRuleAnalyzer::CompiledAggregate PatternRuleAnalyzer::CompileAggregate(
     const rules::AggregateFunction& agg) const {
-    if (!history_service_) throw std::runtime_error("No history service for SQL aggregate");
+    CompiledAggregate compiled;
 
-    std::string sender_account = transaction.sender_account();
-    int64_t last_ts = 0;
-    if (!transaction.timestamp().empty()) {
-        try {
-            last_ts = std::stoll(transaction.timestamp());
-        } catch (...) {}
+    const auto function = agg.function();
+    const bool amount_operand = agg.operand().expr_case() == rules::Expression::kField &&
+                                agg.operand().field().field() == rules::FieldReference::AMOUNT;
+    if (function == rules::AggregateFunction::DECAYED_RATE ||
+        function == rules::AggregateFunction::DECAYED_MEAN ||
+        function == rules::AggregateFunction::DECAYED_STD ||
+        function == rules::AggregateFunction::DECAYED_FREQUENCY) {
+        return CompileDecayedAggregate(agg, std::move(compiled));
     }
-    int max_delta_time = 0;
-    int max_count = 0;
-    if (rule_config_.has_pattern_rule()) {
-        max_delta_time = rule_config_.pattern_rule().max_delta_time();
-        max_count = rule_config_.pattern_rule().max_count();
+
+    const bool quantile = function == rules::AggregateFunction::PERCENTILE ||
+                          function == rules::AggregateFunction::MEDIAN;
+    if (quantile) {
+        if (!amount_operand) {
+            return compiled;
+        }
+        compiled.quantile = function == rules::AggregateFunction::MEDIAN
+            ? 0.5
+            : std::clamp(static_cast<double>(agg.percentile()), 0.0, 100.0) / 100.0;
     }
 
-    std::string sql;
-    std::vector<std::string> params;
-    params.push_back(sender_account);
-    if (max_delta_time > 0) params.push_back(std::to_string(last_ts));
-    if (max_delta_time > 0) params.push_back(std::to_string(max_delta_time));
-    if (max_count > 0) params.push_back(std::to_string(max_count));
+    // Other accounts' transactions are in neither the sender's rollups nor its
+    // sketches; grouped time windows within the horizon come from the keyed
+    // window store and everything else from SQL.
+    if (agg.has_group_by() && agg.group_by().field() != rules::FieldReference::SENDER_ACCOUNT) {
+        compiled.group_by = ToWindowField(agg.group_by().field());
+        if (!compiled.group_by) {
+            return compiled;
+        }
+        const bool window = window_store_ && max_count_ == 0 && max_delta_time_ > 0 &&
+                            max_delta_time_ <= window_store_->GetHorizon();
+        if (window) {
+            switch (function) {
+                case rules::AggregateFunction::COUNT: compiled.window_function = WindowFunction::kCount; break;
+                case rules::AggregateFunction::SUM: if (amount_operand) compiled.window_function = WindowFunction::kSum; break;
+                case rules::AggregateFunction::AVG: if (amount_operand) compiled.window_function = WindowFunction::kAvg; break;
+                case rules::AggregateFunction::MIN: if (amount_operand) compiled.window_function = WindowFunction::kMin; break;
+                case rules::AggregateFunction::MAX: if (amount_operand) compiled.window_function = WindowFunction::kMax; break;
+                case rules::AggregateFunction::COUNT_DISTINCT:
+                    if (agg.operand().expr_case() == rules::Expression::kField) {
+                        if (auto field = ToWindowField(agg.operand().field().field())) {
+                            compiled.window_function = WindowFunction::kCountDistinct;
+                            compiled.window_distinct_field = *field;
+                        }
+                    }
+                    break;
+                default: break;
+            }
+        }
+    } else {
+        // Time windows over the amount are answered from the minute/hour rollups;
+        // the last-N-transactions window still needs the raw rows.
+        compiled.use_rollups =
+            max_count_ == 0 &&
+            (function == rules::AggregateFunction::COUNT ||
+             (amount_operand && (function == rules::AggregateFunction::SUM ||
+                                 function == rules::AggregateFunction::AVG ||
+                                 function == rules::AggregateFunction::MIN ||
+                                 function == rules::AggregateFunction::MAX)));
 
-    std::string field_name;
+        // Sketches cover time windows within their retention, not the last N rows.
+        const bool sketch_window = max_count_ == 0 && max_delta_time_ > 0 &&
+                                   max_delta_time_ <= SketchBuckets::kRetention;
+        compiled.use_amount_digest = quantile && sketch_window;
+        if (function == rules::AggregateFunction::COUNT_DISTINCT && distinct_precision_ > 0 &&
+            sketch_window && agg.operand().expr_case() == rules::Expression::kField) {
+            switch (agg.operand().field().field()) {
+                case rules::FieldReference::RECEIVER_ACCOUNT: compiled.sketch_field = DistinctField::kReceiverAccount; break;
+                case rules::FieldReference::MERCHANT_CATEGORY: compiled.sketch_field = DistinctField::kMerchantCategory; break;
+                case rules::FieldReference::LOCATION: compiled.sketch_field = DistinctField::kLocation; break;
+                case rules::FieldReference::IP_ADDRESS: compiled.sketch_field = DistinctField::kIpAddress; break;
+                case rules::FieldReference::DEVICE_HASH: compiled.sketch_field = DistinctField::kDeviceHash; break;
+                default: break;
+            }
+        }
+    }
+
+    std::string field_name = "1";
     if (agg.operand().expr_case() == rules::Expression::kField) {
         switch (agg.operand().field().field()) {
             case rules::FieldReference::AMOUNT: field_name = "amount"; break;
@@ -144,50 +295,191 @@ rule_utils::ExpressionValue PatternRuleAnalyzer::EvaluateAggregate(
             case rules::FieldReference::TRANSACTION_TYPE: field_name = "transaction_type"; break;
             case rules::FieldReference::RECEIVER_ACCOUNT: field_name = "receiver_account"; break;
             case rules::FieldReference::SENDER_ACCOUNT: field_name = "sender_account"; break;
-            default: throw std::runtime_error("Unsupported field for SQL aggregate");
+            case rules::FieldReference::IP_ADDRESS: field_name = "ip_address"; break;
+            case rules::FieldReference::DEVICE_HASH: field_name = "device_hash"; break;
+            default: return compiled;
         }
     }
 
-    std::string where = "sender_account = $1";
-    int param_idx = 2;
-    if (max_delta_time > 0) {
-        where += " AND times_tamp >= to_timestamp($" + std::to_string(param_idx) + ") - INTERVAL '1 second' * $" + std::to_string(param_idx+1);
-        param_idx += 2;
+    std::string aggregate;
+    switch (function) {
+        case rules::AggregateFunction::COUNT: aggregate = "COUNT(*)"; break;
+        case rules::AggregateFunction::SUM: aggregate = "SUM(value)"; break;
+        case rules::AggregateFunction::AVG: aggregate = "AVG(value)"; break;
+        case rules::AggregateFunction::MIN: aggregate = "MIN(value)"; break;
+        case rules::AggregateFunction::MAX: aggregate = "MAX(value)"; break;
+        case rules::AggregateFunction::COUNT_DISTINCT: aggregate = "COUNT(DISTINCT value)"; break;
+        case rules::AggregateFunction::PERCENTILE:
+        case rules::AggregateFunction::MEDIAN:
+            aggregate = "PERCENTILE_CONT(" + std::to_string(compiled.quantile) +
+                        ") WITHIN GROUP (ORDER BY value)";
+            break;
+        default: return compiled;
     }
-    std::string limit_clause;
-    if (max_count > 0) {
-        limit_clause = " ORDER BY times_tamp DESC LIMIT $" + std::to_string(param_idx);
+
+    const std::string key_column =
+        compiled.group_by ? KeyedWindowStore::ColumnName(*compiled.group_by) : "sender_account";
+
+    // $1 sender account (or group key), $2 window start, $3 row limit (NULL
+    // means no limit). The limit is applied to the rows before aggregating them.
+    // Prepared statements are cached per connection by name, so the name is
+    // derived from the statement: equal aggregates share one, others never clash.
+    std::string statement =
+        "SELECT " + aggregate + "::double precision FROM ("
+        "SELECT " + field_name + " AS value FROM transactions "
+        "WHERE " + key_column + " = $1 AND times_tamp >= $2 "
+        "ORDER BY times_tamp DESC LIMIT $3) recent";
+    std::ostringstream name;
+    name << "pattern_rule_aggregate_" << std::hex << std::hash<std::string>{}(statement);
+    compiled.query = userver::storages::postgres::Query{
+        std::move(statement),
+        userver::storages::postgres::Query::Name{name.str()}};
+    if (max_count_ == 0) {
+        if (function == rules::AggregateFunction::COUNT) {
+            compiled.cache_update = AggregateUpdate::kCount;
+        } else if (function == rules::AggregateFunction::SUM && field_name == "amount") {
+            compiled.cache_update = AggregateUpdate::kSumAmount;
+        }
     }
+    return compiled;
+}
 
-    switch (agg.function()) {
-        case rules::AggregateFunction::COUNT:
-            sql = "SELECT COUNT(*) FROM transactions WHERE " + where + limit_clause;
-            break;
-        case rules::AggregateFunction::SUM:
-            sql = "SELECT SUM(" + field_name + ") FROM transactions WHERE " + where + limit_clause;
-            break;
-        case rules::AggregateFunction::AVG:
-            sql = "SELECT AVG(" + field_name + ") FROM transactions WHERE " + where + limit_clause;
-            break;
-        case rules::AggregateFunction::MIN:
-            sql = "SELECT MIN(" + field_name + ") FROM transactions WHERE " + where + limit_clause;
-            break;
-        case rules::AggregateFunction::MAX:
-            sql = "SELECT MAX(" + field_name + ") FROM transactions WHERE " + where + limit_clause;
-            break;
-        case rules::AggregateFunction::COUNT_DISTINCT:
-            sql = "SELECT COUNT(DISTINCT " + field_name + ") FROM transactions WHERE " + where + limit_clause;
-            break;
-        default:
-            throw std::runtime_error("Unknown aggregate function");
+PatternRuleAnalyzer::CompiledAggregate PatternRuleAnalyzer::CompileDecayedAggregate(
+    const rules::AggregateFunction& agg,
+    CompiledAggregate compiled) const {
+    // Decayed aggregates read the sender's state as of the transaction and
+    // ignore max_delta_time/max_count: the half-life is the window.
+    if (!state_store_) {
+        throw std::invalid_argument("Decayed aggregates require the account state store");
+    }
+    const auto& half_lives = state_store_->GetDecayedHalfLives();
+    const auto it = std::find(half_lives.begin(), half_lives.end(), agg.half_life());
+    if (it == half_lives.end()) {
+        throw std::invalid_argument(
+            "Half-life " + std::to_string(agg.half_life()) + "s is not in decayed_half_lives");
+    }
+
+    const auto operand = agg.operand().expr_case() == rules::Expression::kField
+        ? std::optional{agg.operand().field().field()}
+        : std::nullopt;
+    if ((agg.function() == rules::AggregateFunction::DECAYED_MEAN ||
+         agg.function() == rules::AggregateFunction::DECAYED_STD) &&
+        operand != rules::FieldReference::AMOUNT) {
+        throw std::invalid_argument("DECAYED_MEAN and DECAYED_STD apply to AMOUNT only");
+    }
+    if (agg.function() == rules::AggregateFunction::DECAYED_FREQUENCY &&
+        operand != rules::FieldReference::LOCATION) {
+        throw std::invalid_argument("DECAYED_FREQUENCY applies to LOCATION only");
+    }
+
+    compiled.decayed_index = static_cast<size_t>(it - half_lives.begin());
+    return compiled;
+}
+
+rule_utils::ExpressionValue PatternRuleAnalyzer::EvaluateAggregate(
+    const transaction::Transaction& transaction,
+    const rules::AggregateFunction& agg) const {
+    const auto compiled = aggregates_.find(&agg);
+    if (compiled == aggregates_.end()) {
+        throw std::runtime_error("Aggregate is not part of the rule expression");
     }
 
-    float result = history_service_->ExecuteAggregateQuery(sql, params);
+    const std::string& sender_account = transaction.sender_account();
+    const auto& group_by = compiled->second.group_by;
+    int64_t last_ts = 0;
+    if (!transaction.timestamp().empty()) {
+        try {
+            last_ts = std::stoll(transaction.timestamp());
+        } catch (...) {}
+    }
+    const int64_t since = max_delta_time_ > 0 ? last_ts - max_delta_time_ : 0;
+
+    if (const auto index = compiled->second.decayed_index) {
+        const auto features =
+            state_store_->GetDecayedFeatures(sender_account, last_ts, transaction.location());
+        if (*index >= features.size()) {
+            return 0.0f;
+        }
+        switch (agg.function()) {
+            case rules::AggregateFunction::DECAYED_RATE:
+                return static_cast<float>(features[*index].rate);
+            case rules::AggregateFunction::DECAYED_MEAN:
+                return static_cast<float>(features[*index].amount_mean);
+            case rules::AggregateFunction::DECAYED_STD:
+                return static_cast<float>(features[*index].amount_std);
+            default:
+                return static_cast<float>(features[*index].location_frequency);
+        }
+    }
+
+    if (compiled->second.window_function) {
+        const std::string key{KeyedWindowStore::FieldValue(transaction, *group_by)};
+        if (auto result = window_store_->Aggregate(
+                *group_by, key, since, *compiled->second.window_function,
+                compiled->second.window_distinct_field)) {
+            if (agg.function() == rules::AggregateFunction::COUNT ||
+                agg.function() == rules::AggregateFunction::COUNT_DISTINCT) {
+                return static_cast<int32_t>(*result);
+            }
+            return static_cast<float>(*result);
+        }
+    }
+
+    if (compiled->second.use_rollups) {
+        if (!history_service_) throw std::runtime_error("No history service for rollup aggregate");
+        const auto amounts = history_service_->GetAmountAggregate(sender_account, since);
+        switch (agg.function()) {
+            case rules::AggregateFunction::COUNT:
+                return static_cast<int32_t>(amounts.count);
+            case rules::AggregateFunction::SUM:
+                return static_cast<float>(amounts.sum);
+            case rules::AggregateFunction::AVG:
+                return amounts.count > 0 ? static_cast<float>(amounts.sum / amounts.count) : 0.0f;
+            case rules::AggregateFunction::MIN:
+                return static_cast<float>(amounts.min.value_or(0.0));
+            default:
+                return static_cast<float>(amounts.max.value_or(0.0));
+        }
+    }
+
+    if (const auto field = compiled->second.sketch_field) {
+        const auto precision = static_cast<uint8_t>(distinct_precision_);
+        if (auto estimate = EstimateFromSketches(sender_account, since, [&] {
+                return state_store_->EstimateDistinct(sender_account, *field, since, precision);
+            })) {
+            return static_cast<int32_t>(std::lround(*estimate));
+        }
+    }
+
+    if (compiled->second.use_amount_digest) {
+        const double q = compiled->second.quantile;
+        if (auto estimate = EstimateFromSketches(sender_account, since, [&] {
+                return state_store_->EstimateAmountQuantile(sender_account, since, q);
+            })) {
+            return static_cast<float>(*estimate);
+        }
+    }
+
+    if (!compiled->second.query) {
+        throw std::runtime_error("Unsupported field for SQL aggregate");
+    }
+    if (!history_service_) throw std::runtime_error("No history service for SQL aggregate");
+
+    const auto limit = max_count_ > 0 ? std::optional<int64_t>{max_count_} : std::nullopt;
+    const std::string key =
+        group_by ? std::string{KeyedWindowStore::FieldValue(transaction, *group_by)} : sender_account;
+    const double result = history_service_->ExecuteAggregate(
+        *compiled->second.query,
+        group_by ? KeyedWindowStore::ColumnName(*group_by) : "sender_account",
+        key,
+        since,
+        limit,
+        compiled->second.cache_update);
 
     if (agg.function() == rules::AggregateFunction::COUNT || agg.function() == rules::AggregateFunction::COUNT_DISTINCT) {
         return static_cast<int32_t>(result);
     } else {
-        return result;
+        return static_cast<float>(result);
     }
 }
 
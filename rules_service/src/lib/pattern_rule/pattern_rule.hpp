@@ -1,12 +1,18 @@
 #pragma once
 
 #include "rule_interface/IRule.hpp"
+#include "rule_utils/evaluation_planner.hpp"
 #include "rule_utils/expression_evaluator.hpp"
 #include "transaction_history/transaction_history_service.hpp"
+#include "account_state/account_state_store.hpp"
+#include "transaction_history/keyed_window_store.hpp"
 #include <rules/rule_config.pb.h>
 #include <transaction/transaction.pb.h>
+#include <userver/storages/postgres/query.hpp>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 namespace fraud_detection {
 
@@ -14,13 +20,57 @@ class PatternRuleAnalyzer : public IRule {
 public:
     explicit PatternRuleAnalyzer(
         const rules::RuleConfig& rule_config,
-        std::shared_ptr<TransactionHistoryService> history_service);
+        std::shared_ptr<TransactionHistoryService> history_service,
+        std::shared_ptr<AccountStateStore> state_store = nullptr,
+        std::shared_ptr<KeyedWindowStore> window_store = nullptr);
+
+    PatternRuleAnalyzer(const PatternRuleAnalyzer&) = delete;
+    PatternRuleAnalyzer& operator=(const PatternRuleAnalyzer&) = delete;
 
     bool IsFraudTransaction(const transaction::Transaction& transaction) const override;
 
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const override;
+
 private:
     using ExpressionValue = rule_utils::ExpressionValue;
 
+    // SQL of one aggregate node, built once when the rule is constructed.
+    struct CompiledAggregate {
+        std::optional<userver::storages::postgres::Query> query;
+        // How a cached result of `query` follows transactions saved later.
+        AggregateUpdate cache_update = AggregateUpdate::kNone;
+        bool use_rollups = false;
+        // Set for COUNT_DISTINCT answered from the account's sketches.
+        std::optional<DistinctField> sketch_field;
+        // PERCENTILE/MEDIAN as a 0..1 quantile.
+        double quantile = 0.5;
+        // Set when the quantile is answered from the account's amount digests.
+        bool use_amount_digest = false;
+        // DECAYED_*: index of the half-life in the state store's half-lives.
+        std::optional<size_t> decayed_index;
+        // Set when the aggregate is grouped by a field other than the sender.
+        std::optional<WindowField> group_by;
+        // Set when the grouped window is answered from window_store_.
+        std::optional<WindowFunction> window_function;
+        WindowField window_distinct_field = WindowField::kSenderAccount;
+    };
+
+    void CompileAggregates(const rules::Expression& expr);
+    // Static planner cost of a value node, from how its aggregate is answered.
+    double ValueCost(const rules::Expression& expr) const;
+    CompiledAggregate CompileAggregate(const rules::AggregateFunction& agg) const;
+    CompiledAggregate CompileDecayedAggregate(
+        const rules::AggregateFunction& agg,
+        CompiledAggregate compiled) const;
+
+    // Runs `estimate` against the account's sketches, backfilling them from
+    // history once when they do not reach back to `since`.
+    template <typename Estimate>
+    std::optional<double> EstimateFromSketches(
+        const std::string& account_id,
+        int64_t since,
+        const Estimate& estimate) const;
+
     ExpressionValue EvaluateExpressionValue(
         const transaction::Transaction& transaction,
         const rules::Expression& expr) const;
@@ -43,6 +93,14 @@ private:
 
     const rules::RuleConfig rule_config_;
     std::shared_ptr<TransactionHistoryService> history_service_;
+    std::shared_ptr<AccountStateStore> state_store_;
+    std::shared_ptr<KeyedWindowStore> window_store_;
+    int32_t max_delta_time_ = 0;
+    int32_t max_count_ = 0;
+    int32_t distinct_precision_ = 0;
+    // Keyed by the aggregate nodes of rule_config_, which never changes.
+    std::unordered_map<const rules::AggregateFunction*, CompiledAggregate> aggregates_;
+    std::unique_ptr<rule_utils::EvaluationPlanner> planner_;
 };
 
 }
@@ -10,8 +10,7 @@ namespace fraud_detection {
 
 RulePtr RuleFactory::CreateRuleByType(
     const rules::RuleConfig& config,
-    std::shared_ptr<TransactionHistoryService> history_service,
-    std::shared_ptr<MLFraudDetector> ml_detector) {
+    const RuleDependencies& dependencies) {
     const auto& creators = GetCreators();
     auto it = creators.find(config.rule_type());
     
@@ -20,44 +19,50 @@ RulePtr RuleFactory::CreateRuleByType(
             "Unknown RuleType: " + std::to_string(config.rule_type()));
     }
     
-    return it->second(config, history_service, ml_detector);
+    return it->second(config, dependencies);
 }
 
 const std::unordered_map<rules::RuleConfig_RuleType, RuleFactory::RuleCreator>& 
 RuleFactory::GetCreators() {
     static const std::unordered_map<rules::RuleConfig_RuleType, RuleCreator> creators = {
-        {rules::RuleConfig_RuleType_THRESHOLD, [](const rules::RuleConfig& config, auto, auto) -> RulePtr {
+        {rules::RuleConfig_RuleType_THRESHOLD, [](const rules::RuleConfig& config, const RuleDependencies&) -> RulePtr {
             if (!config.has_threshold_rule()) {
                 throw std::invalid_argument("RuleType is THRESHOLD but threshold_rule not set");
             }
             return std::make_unique<ThresholdRuleAnalyzer>(config);
         }},
-        {rules::RuleConfig_RuleType_PATTERN, [](const rules::RuleConfig& config, 
-                std::shared_ptr<TransactionHistoryService> history_service, auto) -> RulePtr {
+        {rules::RuleConfig_RuleType_PATTERN, [](const rules::RuleConfig& config,
+                const RuleDependencies& dependencies) -> RulePtr {
             if (!config.has_pattern_rule()) {
                 throw std::invalid_argument("RuleType is PATTERN but pattern_rule not set");
             }
-            if (!history_service) {
+            if (!dependencies.history_service) {
                 throw std::invalid_argument("PATTERN rule requires TransactionHistoryService");
             }
-            return std::make_unique<PatternRuleAnalyzer>(config, history_service);
+            return std::make_unique<PatternRuleAnalyzer>(
+                config, dependencies.history_service, dependencies.state_store, dependencies.window_store);
         }},
-        {rules::RuleConfig_RuleType_ML, [](const rules::RuleConfig& config, 
-                std::shared_ptr<TransactionHistoryService> history_service,
-                std::shared_ptr<MLFraudDetector> ml_detector) -> RulePtr {
+        {rules::RuleConfig_RuleType_ML, [](const rules::RuleConfig& config,
+                const RuleDependencies& dependencies) -> RulePtr {
             if (!config.has_ml_rule()) {
                 throw std::invalid_argument("RuleType is ML but ml_rule not set");
             }
+            const auto& model_registry = dependencies.model_registry;
+            if (!model_registry) {
+                throw std::invalid_argument("ML rule requires MLModelRegistry");
+            }
+            auto ml_detector = model_registry->Get(config.ml_rule().model_uuid());
             if (!ml_detector) {
-                throw std::invalid_argument("ML rule requires MLFraudDetector");
+                throw std::invalid_argument("Model config not found for uuid: " + config.ml_rule().model_uuid());
             }
-            if (!history_service) {
+            if (!dependencies.history_service) {
                 throw std::invalid_argument("ML rule requires TransactionHistoryService for feature extraction");
             }
-            auto history_provider = std::make_shared<RedisHistoryProvider>(history_service);
-            return std::make_unique<MlRuleAnalyzer>(config, ml_detector, history_provider);
+            auto history_provider = std::make_shared<RedisHistoryProvider>(dependencies.history_service);
+            return std::make_unique<MlRuleAnalyzer>(
+                config, ml_detector, history_provider, dependencies.state_store);
         }},
-        {rules::RuleConfig_RuleType_COMPOSITE, [](const rules::RuleConfig& config, auto, auto) -> RulePtr {
+        {rules::RuleConfig_RuleType_COMPOSITE, [](const rules::RuleConfig& config, const RuleDependencies&) -> RulePtr {
             if (!config.has_composite_rule()) {
                 throw std::invalid_argument("RuleType is COMPOSITE but composite_rule not set");
             }
@@ -8,22 +8,29 @@
 #include "transaction_history/transaction_history_service.hpp"
 #include "ml_model/ml_fraud_detector.hpp"
 #include "ml_model/redis_history_provider.hpp"
+#include "ml_model/model_registry.hpp"
+#include "account_state/account_state_store.hpp"
+#include "transaction_history/keyed_window_store.hpp"
 #include <rules/rule_config.pb.h>
 
 namespace fraud_detection {
 
+// Services rules are built on; any of them may be null when unavailable.
+struct RuleDependencies {
+    std::shared_ptr<TransactionHistoryService> history_service;
+    std::shared_ptr<MLModelRegistry> model_registry;
+    std::shared_ptr<AccountStateStore> state_store;
+    std::shared_ptr<KeyedWindowStore> window_store;
+};
+
 class RuleFactory {
 public:
     static RulePtr CreateRuleByType(
         const rules::RuleConfig& config,
-        std::shared_ptr<TransactionHistoryService> history_service = nullptr,
-        std::shared_ptr<MLFraudDetector> ml_detector = nullptr);
+        const RuleDependencies& dependencies = {});
 
 private:
-    using RuleCreator = std::function<RulePtr(
-        const rules::RuleConfig&,
-        std::shared_ptr<TransactionHistoryService>,
-        std::shared_ptr<MLFraudDetector>)>;
+    using RuleCreator = std::function<RulePtr(const rules::RuleConfig&, const RuleDependencies&)>;
     static const std::unordered_map<rules::RuleConfig_RuleType, RuleCreator>& GetCreators();
 };
 
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <transaction/transaction.pb.h>
+#include <userver/utils/statistics/writer.hpp>
 
 namespace fraud_detection {
 
@@ -11,6 +12,9 @@ public:
 
     virtual bool IsFraudTransaction(
         const transaction::Transaction& transaction) const = 0;
+
+    // Rule-specific runtime statistics, e.g. the evaluation plan.
+    virtual void WriteStatistics(userver::utils::statistics::Writer& /*writer*/) const {}
 };
 
 using RulePtr = std::unique_ptr<IRule>;
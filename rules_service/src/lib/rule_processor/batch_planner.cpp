@@ -0,0 +1,69 @@
+#include "batch_planner.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+// Parsed messages and their results take a few times the wire size; the
+// first block is sized for that so a typical batch needs a single block.
+constexpr size_t kArenaBytesPerPayloadByte = 4;
+constexpr size_t kMinArenaBlock = 16 * 1024;
+constexpr size_t kMaxArenaBlock = 8 * 1024 * 1024;
+
+std::unique_ptr<google::protobuf::Arena> MakeBatchArena(const userver::kafka::MessageBatchView& messages) {
+    size_t payload_bytes = 0;
+    for (const auto& msg : messages) {
+        payload_bytes += msg.GetPayload().size();
+    }
+    google::protobuf::ArenaOptions options;
+    options.start_block_size =
+        std::clamp(payload_bytes * kArenaBytesPerPayloadByte, kMinArenaBlock, kMaxArenaBlock);
+    options.max_block_size = kMaxArenaBlock;
+    return std::make_unique<google::protobuf::Arena>(options);
+}
+
+}  // namespace
+
+BatchPlan BatchPlanner::Build(const userver::kafka::MessageBatchView& messages) {
+    BatchPlan plan;
+    plan.total_messages = messages.size();
+    plan.arena = MakeBatchArena(messages);
+
+    std::unordered_map<std::string_view, size_t> group_index;
+    group_index.reserve(messages.size());
+
+    for (const auto& msg : messages) {
+        const auto payload = msg.GetPayload();
+
+        // Parsed straight from the payload the consumer holds, onto the arena.
+        auto* request = google::protobuf::Arena::Create<rules::RuleRequest>(plan.arena.get());
+        if (!request->ParseFromArray(payload.data(), static_cast<int>(payload.size()))) {
+            LOG_ERROR() << "Failed to parse RuleRequest from message";
+            ++plan.malformed_messages;
+            continue;
+        }
+
+        const std::string_view transaction_id = request->transaction().transaction_id();
+        auto [it, inserted] = group_index.try_emplace(transaction_id, plan.groups.size());
+        if (inserted) {
+            auto& group = plan.groups.emplace_back();
+            group.transaction_id = transaction_id;
+            group.partition = static_cast<uint32_t>(msg.GetPartition());
+            group.first_offset = static_cast<int64_t>(msg.GetOffset());
+            group.transaction = &request->transaction();
+        }
+        plan.groups[it->second].requests.push_back(request);
+    }
+
+    LOG_INFO() << "Planned batch of " << plan.total_messages << " messages into "
+               << plan.groups.size() << " transaction groups ("
+               << plan.malformed_messages << " malformed)";
+    return plan;
+}
+
+}  // namespace fraud_detection
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+
+#include <userver/kafka/message.hpp>
+
+#include <rules/rule_request.pb.h>
+#include <transaction/transaction.pb.h>
+
+namespace fraud_detection {
+
+// All rule requests of one Kafka batch that refer to the same transaction.
+// The transaction is saved, its history is fetched and its rules are
+// evaluated once per group instead of once per message. The messages live
+// on the arena of the plan.
+struct TransactionGroup {
+    std::string_view transaction_id;
+    uint32_t partition = 0;
+    int64_t first_offset = 0;
+    const transaction::Transaction* transaction = nullptr;
+    std::vector<const rules::RuleRequest*> requests;
+};
+
+struct BatchPlan {
+    // Owns the parsed requests and whatever else the batch allocates on it
+    // (the results), all freed at once with the plan.
+    std::unique_ptr<google::protobuf::Arena> arena;
+    std::vector<TransactionGroup> groups;
+    size_t total_messages = 0;
+    size_t malformed_messages = 0;
+};
+
+class BatchPlanner {
+public:
+    // Parses every message of the batch up front and groups the requests by
+    // transaction_id, keeping the order in which transactions first appear.
+    static BatchPlan Build(const userver::kafka::MessageBatchView& messages);
+};
+
+}  // namespace fraud_detection
@@ -0,0 +1,120 @@
+#include "rule_catalog.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include <userver/logging/log.hpp>
+
+#include "account_state/binary_io.hpp"
+
+namespace fraud_detection {
+
+RuleCatalog::RuleCatalog(RuleDependencies dependencies)
+    : dependencies_(std::move(dependencies)) {}
+
+std::shared_ptr<const IRule> RuleCatalog::GetOrCompile(const rules::RuleConfig& config) {
+    auto fingerprint = config.SerializeAsString();
+    {
+        std::shared_lock lock(mutex_);
+        auto it = rules_.find(config.uuid());
+        if (it != rules_.end() && it->second.fingerprint == fingerprint) {
+            return it->second.rule;
+        }
+    }
+
+    std::shared_ptr<const IRule> rule = RuleFactory::CreateRuleByType(config, dependencies_);
+    LOG_INFO() << "Compiled rule " << config.uuid() << " (" << config.name() << ")";
+
+    std::lock_guard lock(mutex_);
+    rules_[config.uuid()] = Entry{std::move(fingerprint), rule};
+    dirty_ = true;
+    return rule;
+}
+
+size_t RuleCatalog::LoadFromFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_INFO() << "No rule catalog found at " << path;
+        return 0;
+    }
+    const std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    BinaryReader reader(data);
+    std::string_view serialized;
+    size_t compiled = 0;
+    while (!reader.Empty() && reader.ReadStringView(serialized)) {
+        rules::RuleConfig config;
+        if (!config.ParseFromArray(serialized.data(), static_cast<int>(serialized.size()))) {
+            LOG_WARNING() << "Skipping malformed rule in catalog " << path;
+            continue;
+        }
+        try {
+            GetOrCompile(config);
+            ++compiled;
+        } catch (const std::exception& e) {
+            LOG_WARNING() << "Failed to compile known rule " << config.uuid() << ": " << e.what();
+        }
+    }
+
+    std::lock_guard lock(mutex_);
+    dirty_ = false;
+    LOG_INFO() << "Compiled " << compiled << " known rules from " << path;
+    return compiled;
+}
+
+bool RuleCatalog::SaveToFile(const std::string& path) {
+    std::string data;
+    {
+        std::lock_guard lock(mutex_);
+        if (!dirty_) {
+            return true;
+        }
+        BinaryWriter writer(data);
+        for (const auto& [uuid, entry] : rules_) {
+            writer.WriteString(entry.fingerprint);
+        }
+        dirty_ = false;
+    }
+
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            LOG_ERROR() << "Failed to write rule catalog " << tmp_path;
+            MarkDirty();
+            return false;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOG_ERROR() << "Failed to replace rule catalog " << path;
+        MarkDirty();
+        return false;
+    }
+    LOG_INFO() << "Saved rule catalog " << path;
+    return true;
+}
+
+void RuleCatalog::MarkDirty() {
+    std::lock_guard lock(mutex_);
+    dirty_ = true;
+}
+
+size_t RuleCatalog::Size() const {
+    std::shared_lock lock(mutex_);
+    return rules_.size();
+}
+
+void RuleCatalog::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    std::shared_lock lock(mutex_);
+    for (const auto& [uuid, entry] : rules_) {
+        auto rule_writer = writer[uuid];
+        entry.rule->WriteStatistics(rule_writer);
+    }
+}
+
+}  // namespace fraud_detection
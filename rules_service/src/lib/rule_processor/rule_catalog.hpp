@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <userver/engine/shared_mutex.hpp>
+
+#include <rules/rule_config.pb.h>
+
+#include "rule_interface/IRule.hpp"
+#include "rule_factory/rule_factory.hpp"
+
+namespace fraud_detection {
+
+// Compiled rules by uuid. A rule is built by RuleFactory the first time its
+// config is seen and rebuilt only when the config changes, instead of once
+// per request. The known configs can be persisted and compiled at startup.
+class RuleCatalog {
+public:
+    explicit RuleCatalog(RuleDependencies dependencies);
+
+    std::shared_ptr<const IRule> GetOrCompile(const rules::RuleConfig& config);
+
+    // Blocking file I/O, run on a blocking task processor.
+    size_t LoadFromFile(const std::string& path);
+    bool SaveToFile(const std::string& path);
+
+    size_t Size() const;
+
+    // Statistics of every compiled rule, one section per rule uuid.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    void MarkDirty();
+
+    struct Entry {
+        std::string fingerprint;
+        std::shared_ptr<const IRule> rule;
+    };
+
+    const RuleDependencies dependencies_;
+
+    mutable userver::engine::SharedMutex mutex_;
+    std::unordered_map<std::string, Entry> rules_;
+    bool dirty_ = false;
+};
+
+}  // namespace fraud_detection
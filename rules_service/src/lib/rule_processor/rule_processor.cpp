@@ -1,12 +1,31 @@
 #include "rule_processor.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <userver/engine/async.hpp>
+#include <userver/engine/task/current_task.hpp>
 #include <userver/logging/log.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/yaml_config/schema.hpp>
 
 namespace fraud_detection {
+
+namespace {
+
+class EmptyHistoryProvider final : public TransactionHistoryProvider {
+public:
+    std::vector<transaction::Transaction> GetAccountHistory(const std::string&, int64_t) override {
+        return {};
+    }
+};
+
+}  // namespace
     
 RuleProcessor::RuleProcessor(
     const userver::components::ComponentConfig& config,
@@ -16,7 +35,10 @@ RuleProcessor::RuleProcessor(
       producer_(context.FindComponent<userver::kafka::ProducerComponent>("kafka-producer")),
       request_topic_(config["request_topic"].As<std::string>("Request")),
       response_topic_(config["response_topic"].As<std::string>("Response")),
-      consumer_scope_(consumer_.GetConsumer()) {
+      consumer_scope_(consumer_.GetConsumer()),
+      fs_task_processor_(context.GetTaskProcessor(
+          config["fs_task_processor"].As<std::string>("fs-task-processor"))),
+      batch_concurrency_(std::max<size_t>(config["batch_concurrency"].As<size_t>(8), 1)) {
     try {
         auto& pg_component = context.FindComponent<userver::components::Postgres>("postgres-db-1");
         auto pg_cluster = pg_component.GetCluster();
@@ -34,7 +56,21 @@ RuleProcessor::RuleProcessor(
             throw;
         }
 
-        history_service_ = std::make_shared<TransactionHistoryService>(pg_cluster);
+        ReplicaReadRouter::Settings router_settings;
+        router_settings.enabled = config["replica_reads_enabled"].As<bool>(true);
+        router_settings.max_wait = std::chrono::milliseconds(
+            config["replica_max_wait_ms"].As<int>(50));
+        router_settings.max_keys = config["replica_tracked_keys"].As<size_t>(100000);
+        auto read_router = std::make_shared<ReplicaReadRouter>(pg_cluster, router_settings);
+        std::shared_ptr<AggregateResultCache> aggregate_cache;
+        AggregateResultCache::Settings cache_settings;
+        cache_settings.max_keys = config["aggregate_cache_max_keys"].As<size_t>(100000);
+        cache_settings.ttl = std::chrono::milliseconds(config["aggregate_cache_ttl_ms"].As<int>(1000));
+        cache_settings.since_bucket_seconds = config["aggregate_cache_since_bucket"].As<int64_t>(10);
+        if (cache_settings.max_keys > 0 && cache_settings.ttl.count() > 0) {
+            aggregate_cache = std::make_shared<AggregateResultCache>(cache_settings);
+        }
+        history_service_ = std::make_shared<TransactionHistoryService>(pg_cluster, read_router, aggregate_cache);
         history_provider_ = std::make_shared<RedisHistoryProvider>(history_service_);
         LOG_INFO() << "TransactionHistoryService initialized with PostgreSQL";
     } catch (const std::exception& e) {
@@ -43,24 +79,82 @@ RuleProcessor::RuleProcessor(
         history_provider_ = nullptr;
     }
 
-    ml_detector_ = std::make_shared<MLFraudDetector>();
     model_config_dir_ = config["ml_model_config_dir"].As<std::string>(
         "./model_configs");
-    
+    inference_executor_ = std::make_shared<InferenceExecutor>(
+        context.GetTaskProcessor(
+            config["inference_task_processor"].As<std::string>("inference-task-processor")),
+        config["inference_max_pending"].As<size_t>(64));
+    model_registry_ = std::make_shared<MLModelRegistry>(
+        model_config_dir_,
+        inference_executor_,
+        config["ml_model_artifact_dir"].As<std::string>(model_config_dir_));
+    state_store_ = std::make_shared<AccountStateStore>(
+        config["account_state_shards"].As<size_t>(64),
+        config["decayed_half_lives"].As<std::vector<int64_t>>(std::vector<int64_t>{3600, 86400, 2592000}));
+    if (history_service_) {
+        KeyedWindowStore::Settings window_settings;
+        window_settings.max_keys = config["keyed_window_max_keys"].As<size_t>(100000);
+        window_settings.max_events_per_key = config["keyed_window_max_events"].As<size_t>(4096);
+        window_settings.horizon_seconds = config["keyed_window_horizon"].As<int64_t>(24 * 3600);
+        window_settings.ttl = std::chrono::milliseconds(config["keyed_window_ttl_ms"].As<int>(5000));
+        window_store_ = std::make_shared<KeyedWindowStore>(history_service_, window_settings);
+    }
+    rule_catalog_ = std::make_shared<RuleCatalog>(
+        RuleDependencies{history_service_, model_registry_, state_store_, window_store_});
+    rule_catalog_path_ = config["rule_catalog_path"].As<std::string>("");
 
     result_producer_ = std::make_unique<KafkaResultProducer>(producer_);
+
+    const auto snapshot_path = config["state_snapshot_path"].As<std::string>("");
+    if (!snapshot_path.empty()) {
+        snapshot_file_ = std::make_unique<StateSnapshotFile>(snapshot_path);
+        restored_snapshot_ = userver::engine::AsyncNoSpan(fs_task_processor_, [this] {
+            return snapshot_file_->Read();
+        }).Get();
+    }
+    if (snapshot_file_ || !rule_catalog_path_.empty()) {
+        const auto snapshot_interval = std::chrono::seconds(
+            config["state_snapshot_interval"].As<int>(60));
+        snapshot_task_.Start("account-state-snapshot", {snapshot_interval}, [this] {
+            WriteStateSnapshot();
+        });
+    }
+
+    const auto partition_maintenance_interval = std::chrono::seconds(
+        config["partition_maintenance_interval"].As<int>(3600));
+    if (history_service_ && partition_maintenance_interval.count() > 0) {
+        const auto days_ahead = config["partition_days_ahead"].As<int>(7);
+        const auto retention_days = config["partition_retention_days"].As<int>(90);
+        partition_maintenance_task_.Start(
+            "transaction-partition-maintenance",
+            {partition_maintenance_interval, userver::utils::PeriodicTask::Flags::kNow},
+            [this, days_ahead, retention_days] {
+                history_service_->MaintainPartitions(days_ahead, retention_days);
+            });
+    }
+
+    statistics_entry_ = context.FindComponent<userver::components::StatisticsStorage>()
+        .GetStorage()
+        .RegisterWriter("fraud_detection", [this](userver::utils::statistics::Writer& writer) {
+            WriteStatistics(writer);
+        });
+
+    Warmup(config["warmup_hot_accounts"].As<int>(0), config["warmup_predictions"].As<int>(3));
     
     LOG_INFO() << "RuleProcessor initialized. Listening to topic: " << request_topic_;
     LOG_INFO() << "Response topic: " << response_topic_;
+    consumer_scope_.SetRebalanceCallback(
+        [this](userver::kafka::TopicPartitionBatchView partitions,
+               userver::kafka::RebalanceEventType event) {
+            OnRebalance(partitions, event);
+        });
     consumer_scope_.Start([this](userver::kafka::MessageBatchView messages) {
         LOG_INFO() << "Received batch of " << messages.size() << " messages";
-        for (const auto& msg : messages) {
-            try {
-                std::string message_data(msg.GetPayload().begin(), msg.GetPayload().end());
-                ProcessMessage(message_data);
-            } catch (const std::exception& e) {
-                LOG_ERROR() << "Error processing Kafka message: " << e.what();
-            }
+        try {
+            ProcessBatch(BatchPlanner::Build(messages));
+        } catch (const std::exception& e) {
+            LOG_ERROR() << "Error processing Kafka batch: " << e.what();
         }
     });
     LOG_INFO() << "RuleProcessor consumer started and ready to receive messages";
@@ -68,15 +162,183 @@ RuleProcessor::RuleProcessor(
 
 RuleProcessor::~RuleProcessor() {
     LOG_INFO() << "RuleProcessor shutting down";
+    statistics_entry_.Unregister();
+    partition_maintenance_task_.Stop();
+    snapshot_task_.Stop();
+    consumer_scope_.Stop();
+    if (snapshot_file_ || !rule_catalog_path_.empty()) {
+        try {
+            WriteStateSnapshot();
+        } catch (const std::exception& e) {
+            LOG_ERROR() << "Failed to write final state snapshot: " << e.what();
+        }
+    }
+}
+
+void RuleProcessor::OnRebalance(
+    userver::kafka::TopicPartitionBatchView partitions,
+    userver::kafka::RebalanceEventType event) {
+    std::vector<uint32_t> partition_ids;
+    std::unordered_map<uint32_t, int64_t> committed_offsets;
+    for (const auto& partition : partitions) {
+        if (partition.topic == request_topic_) {
+            partition_ids.push_back(partition.partition_id);
+            if (partition.offset) {
+                committed_offsets[partition.partition_id] = static_cast<int64_t>(*partition.offset);
+            }
+        }
+    }
+
+    switch (event) {
+        case userver::kafka::RebalanceEventType::kAssigned:
+            LOG_INFO() << "Assigned " << partition_ids.size() << " partitions of " << request_topic_;
+            AssignPartitions(partition_ids, committed_offsets);
+            break;
+        case userver::kafka::RebalanceEventType::kRevoked:
+            LOG_INFO() << "Revoked " << partition_ids.size() << " partitions of " << request_topic_;
+            {
+                std::lock_guard lock(replay_mutex_);
+                for (auto partition_id : partition_ids) {
+                    replay_end_offsets_.erase(partition_id);
+                }
+            }
+            state_store_->RevokePartitions(partition_ids);
+            break;
+    }
 }
 
-void RuleProcessor::ProcessMessage(const std::string& message) {
-    GOOGLE_PROTOBUF_VERIFY_VERSION;
-    rules::RuleRequest request;
-    if (!request.ParseFromString(message)) {
-        LOG_ERROR() << "Failed to parse RuleRequest from message";
-        
-        rules::RuleResult error_result;
+void RuleProcessor::AssignPartitions(
+    const std::vector<uint32_t>& partitions,
+    const std::unordered_map<uint32_t, int64_t>& committed_offsets) {
+    std::vector<uint32_t> fresh_partitions;
+    std::lock_guard lock(restored_snapshot_mutex_);
+    std::lock_guard replay_lock(replay_mutex_);
+    for (auto partition_id : partitions) {
+        replay_end_offsets_.erase(partition_id);
+
+        std::optional<AccountStateStore::PartitionSnapshot> restored;
+        if (restored_snapshot_) {
+            auto& snapshot_partitions = restored_snapshot_->partitions;
+            auto it = std::find_if(snapshot_partitions.begin(), snapshot_partitions.end(),
+                [partition_id](const auto& p) { return p.partition == partition_id; });
+            if (it != snapshot_partitions.end()) {
+                restored = std::move(*it);
+                snapshot_partitions.erase(it);
+            }
+        }
+
+        if (!restored) {
+            fresh_partitions.push_back(partition_id);
+            continue;
+        }
+
+        // Rewind to the message after the snapshot, so only the Kafka tail
+        // since the snapshot is replayed. Requests below the committed offset
+        // were answered before; they rebuild state without being evaluated.
+        const auto resume_offset = static_cast<uint64_t>(restored->applied_offset + 1);
+        state_store_->RestorePartition(std::move(*restored));
+        const auto committed = committed_offsets.find(partition_id);
+        if (committed == committed_offsets.end()) {
+            LOG_WARNING() << "No committed offset for partition " << partition_id
+                          << ", replayed requests are evaluated again";
+        } else if (committed->second > static_cast<int64_t>(resume_offset)) {
+            replay_end_offsets_[partition_id] = committed->second;
+        }
+        try {
+            consumer_scope_.Seek(request_topic_, partition_id, resume_offset, std::chrono::seconds(1));
+            LOG_INFO() << "Replaying partition " << partition_id << " from offset " << resume_offset;
+        } catch (const std::exception& e) {
+            LOG_WARNING() << "Failed to seek partition " << partition_id << " to snapshot offset "
+                          << resume_offset << ": " << e.what();
+        }
+    }
+    state_store_->AssignPartitions(fresh_partitions);
+}
+
+void RuleProcessor::Warmup(int hot_accounts, int predictions_per_model) {
+    const auto started = std::chrono::steady_clock::now();
+    LOG_INFO() << "RuleProcessor warmup started";
+
+    model_registry_->LoadAll(fs_task_processor_);
+
+    if (!rule_catalog_path_.empty()) {
+        userver::engine::AsyncNoSpan(fs_task_processor_, [this] {
+            rule_catalog_->LoadFromFile(rule_catalog_path_);
+        }).Get();
+    }
+
+    if (history_service_ && hot_accounts > 0) {
+        // Pulls the history of the busiest accounts through the same queries
+        // the rules run, so indexes and heap pages are hot in PostgreSQL.
+        auto accounts = history_service_->GetMostActiveAccounts(hot_accounts, 1);
+        std::vector<userver::engine::TaskWithResult<void>> tasks;
+        tasks.reserve(accounts.size());
+        for (auto& account : accounts) {
+            tasks.push_back(userver::engine::AsyncNoSpan(
+                userver::engine::current_task::GetTaskProcessor(),
+                [this, account = std::move(account)] {
+                    history_service_->GetAccountHistory(account, 1000);
+                }));
+        }
+        for (auto& task : tasks) {
+            task.Get();
+        }
+        LOG_INFO() << "Prefetched history of " << accounts.size() << " most active accounts";
+    }
+
+    if (predictions_per_model > 0) {
+        // Synthetic predictions fault in model pages and warm allocator and
+        // library caches before real traffic arrives.
+        EmptyHistoryProvider empty_history;
+        transaction::Transaction synthetic;
+        synthetic.set_transaction_id("warmup");
+        synthetic.set_sender_account("warmup");
+        synthetic.set_amount(100.0f);
+        synthetic.set_timestamp(std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()));
+
+        for (const auto& uuid : model_registry_->GetLoadedUuids()) {
+            auto detector = model_registry_->Get(uuid);
+            for (int i = 0; i < predictions_per_model && detector; ++i) {
+                try {
+                    detector->PredictFraudProbability(synthetic, empty_history);
+                } catch (const std::exception& e) {
+                    LOG_WARNING() << "Warmup prediction failed for model " << uuid << ": " << e.what();
+                    break;
+                }
+            }
+        }
+    }
+
+    LOG_INFO() << "RuleProcessor warmup finished in "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - started).count()
+               << " ms: " << model_registry_->GetLoadedUuids().size() << " models, "
+               << rule_catalog_->Size() << " rules";
+}
+
+void RuleProcessor::WriteStateSnapshot() {
+    std::optional<AccountStateStore::Snapshot> snapshot;
+    if (snapshot_file_) {
+        // Lanes apply a batch out of offset order, so the applied offsets
+        // are only a resume point once the whole batch is in.
+        std::lock_guard lock(batch_mutex_);
+        snapshot = state_store_->TakeSnapshot();
+    }
+    userver::engine::AsyncNoSpan(fs_task_processor_, [this, &snapshot] {
+        if (snapshot) {
+            snapshot_file_->Write(*snapshot);
+        }
+        if (!rule_catalog_path_.empty()) {
+            rule_catalog_->SaveToFile(rule_catalog_path_);
+        }
+    }).Get();
+}
+
+void RuleProcessor::ProcessBatch(const BatchPlan& plan) {
+    std::lock_guard batch_lock(batch_mutex_);
+    for (size_t i = 0; i < plan.malformed_messages; ++i) {
+        auto& error_result = *google::protobuf::Arena::Create<rules::RuleResult>(plan.arena.get());
         error_result.set_status(rules::RuleResult::ERROR);
         error_result.set_profile_uuid("");
         error_result.set_profile_name("");
@@ -84,36 +346,175 @@ void RuleProcessor::ProcessMessage(const std::string& message) {
         error_result.set_config_name("Failed to parse request");
         error_result.set_transaction_id("");
         error_result.set_description("Failed to parse RuleRequest from Kafka message");
-        
+
         SendResultToService(error_result);
+    }
+
+    // One lane per sender keeps an account's transactions in batch order,
+    // while different accounts are evaluated concurrently, so one slow
+    // aggregate only holds up its own account. Each transaction is recorded
+    // right before its rules run, so windows never see later transactions of
+    // the same batch.
+    std::vector<std::vector<const TransactionGroup*>> lanes;
+    std::unordered_map<std::string_view, size_t> lane_by_sender;
+    for (const auto* group : ReplayAnswered(plan)) {
+        auto [it, inserted] = lane_by_sender.try_emplace(group->transaction->sender_account(), lanes.size());
+        if (inserted) {
+            lanes.emplace_back();
+        }
+        lanes[it->second].push_back(group);
+    }
+
+    auto process_lane = [this, arena = plan.arena.get()](const std::vector<const TransactionGroup*>& lane) {
+        for (const auto* group : lane) {
+            try {
+                RecordTransaction(*group);
+                ProcessTransactionGroup(*group, arena);
+            } catch (const std::exception& e) {
+                LOG_ERROR() << "Error processing transaction " << group->transaction_id << ": " << e.what();
+                SendGroupError(*group, arena, e.what());
+            }
+        }
+    };
+
+    const size_t workers = std::min(batch_concurrency_, lanes.size());
+    if (workers <= 1) {
+        for (const auto& lane : lanes) {
+            process_lane(lane);
+        }
         return;
     }
-    
+
+    // The consumer commits the batch once this callback returns, so every
+    // worker is joined before that.
+    std::atomic<size_t> next_lane{0};
+    std::vector<userver::engine::TaskWithResult<void>> tasks;
+    tasks.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        tasks.push_back(userver::engine::AsyncNoSpan(
+            userver::engine::current_task::GetTaskProcessor(),
+            [&lanes, &next_lane, &process_lane] {
+                for (size_t lane = next_lane++; lane < lanes.size(); lane = next_lane++) {
+                    process_lane(lanes[lane]);
+                }
+            }));
+    }
+    for (auto& task : tasks) {
+        task.Get();
+    }
+}
+
+std::vector<const TransactionGroup*> RuleProcessor::ReplayAnswered(const BatchPlan& plan) {
+    std::vector<const TransactionGroup*> replayed;
+    std::vector<const TransactionGroup*> pending;
+    pending.reserve(plan.groups.size());
+    {
+        std::lock_guard lock(replay_mutex_);
+        for (const auto& group : plan.groups) {
+            const auto it = replay_end_offsets_.find(group.partition);
+            if (it == replay_end_offsets_.end()) {
+                pending.push_back(&group);
+            } else if (group.first_offset < it->second) {
+                replayed.push_back(&group);
+            } else {
+                replay_end_offsets_.erase(it);
+                pending.push_back(&group);
+            }
+        }
+    }
+
+    for (const auto* group : replayed) {
+        try {
+            RecordTransaction(*group);
+        } catch (const std::exception& e) {
+            LOG_ERROR() << "Error replaying transaction " << group->transaction_id << ": " << e.what();
+        }
+    }
+    if (!replayed.empty()) {
+        LOG_INFO() << "Replayed " << replayed.size() << " already answered transactions into state";
+    }
+    return pending;
+}
+
+void RuleProcessor::RecordTransaction(const TransactionGroup& group) {
+    if (history_service_) {
+        history_service_->SaveTransaction(*group.transaction);
+        if (window_store_) {
+            window_store_->Append({*group.transaction});
+        }
+    }
+    state_store_->Apply(group.partition, group.first_offset, *group.transaction);
+}
+
+void RuleProcessor::ProcessTransactionGroup(const TransactionGroup& group, google::protobuf::Arena* arena) {
+    LOG_INFO() << "Processing " << group.requests.size() << " rules for transaction: "
+               << group.transaction_id;
+
+    std::optional<CachedHistoryProvider> group_history;
+    std::optional<CachedHistoryProvider::Scope> history_scope;
+    if (history_provider_) {
+        group_history.emplace(*history_provider_);
+        history_scope.emplace(*group_history);
+    }
+
+    // Results are released with the batch arena, not one by one.
+    std::vector<const rules::RuleResult*> results;
+    results.reserve(group.requests.size());
+    for (const auto* request : group.requests) {
+        auto* result = google::protobuf::Arena::Create<rules::RuleResult>(arena);
+        EvaluateRequest(*request, *group.transaction, group_history ? &*group_history : nullptr, *result);
+        results.push_back(result);
+    }
+
+    for (const auto* result : results) {
+        SendResultToService(*result);
+    }
+}
+
+void RuleProcessor::SendGroupError(
+    const TransactionGroup& group,
+    google::protobuf::Arena* arena,
+    std::string_view error) {
+    for (const auto* request : group.requests) {
+        auto& error_result = *google::protobuf::Arena::Create<rules::RuleResult>(arena);
+        error_result.set_status(rules::RuleResult::ERROR);
+        error_result.set_profile_uuid(request->profile_uuid());
+        error_result.set_profile_name(request->profile_name());
+        error_result.set_config_uuid(request->rule().uuid());
+        error_result.set_config_name(request->rule().name());
+        error_result.set_transaction_id(std::string{group.transaction_id});
+        error_result.set_description("Error: " + std::string{error});
+
+        SendResultToService(error_result);
+    }
+}
+
+void RuleProcessor::EvaluateRequest(
+    const rules::RuleRequest& request,
+    const transaction::Transaction& transaction,
+    TransactionHistoryProvider* history,
+    rules::RuleResult& result) {
     LOG_INFO() << "Processing rule: " << request.rule().uuid() 
-               << " for transaction: " << request.transaction().transaction_id();
+               << " for transaction: " << transaction.transaction_id();
     
-    rules::RuleResult result;
     result.set_profile_uuid(request.profile_uuid());
     result.set_profile_name(request.profile_name());
     result.set_config_uuid(request.rule().uuid());
     result.set_config_name(request.rule().name());
-    result.set_transaction_id(request.transaction().transaction_id());
+    result.set_transaction_id(transaction.transaction_id());
     
     try {
-        if (history_service_) {
-            history_service_->SaveTransaction(request.transaction());
-            LOG_DEBUG() << "Saved transaction " << request.transaction().transaction_id() 
-                       << " to PostgreSQL history";
-        }
-        
-        if (request.rule().rule_type() == rules::RuleConfig::ML && ml_detector_ && history_provider_) {
+        if (request.rule().rule_type() == rules::RuleConfig::ML && history) {
             std::string uuid = request.rule().ml_rule().model_uuid();
-            if (!ml_detector_->LoadModelByUuid(model_config_dir_, uuid)) {
+            auto ml_detector = model_registry_->Get(uuid);
+            if (!ml_detector) {
                 result.set_status(rules::RuleResult::ERROR);
                 result.set_description("Model config not found for uuid: " + uuid);
                 LOG_ERROR() << "Model config not found for uuid: " << uuid;
             } else {
-                double fraud_probability = ml_detector_->PredictFraudProbability(request.transaction(), *history_provider_);
+                const auto decayed = state_store_->GetDecayedFeatures(
+                    transaction.sender_account(), std::stoll(transaction.timestamp()), transaction.location());
+                double fraud_probability = ml_detector->PredictFraudProbability(transaction, *history, decayed);
                 double threshold = request.rule().ml_rule().lower_bound();
                 bool is_fraud = fraud_probability >= threshold;
                 std::ostringstream desc;
@@ -125,27 +526,27 @@ void RuleProcessor::ProcessMessage(const std::string& message) {
                     bool is_critical = request.rule().is_critical();
                     if (is_critical) {
                         result.set_status(rules::RuleResult::CRITICAL);
-                        LOG_ERROR() << "CRITICAL FRAUD detected for transaction: " << request.transaction().transaction_id()
+                        LOG_ERROR() << "CRITICAL FRAUD detected for transaction: " << transaction.transaction_id()
                                    << " by ML rule with probability: " << fraud_probability 
                                    << " (is_critical=true)";
                     } else {
                         result.set_status(rules::RuleResult::FRAUD);
-                        LOG_WARNING() << "FRAUD detected for transaction: " << request.transaction().transaction_id()
+                        LOG_WARNING() << "FRAUD detected for transaction: " << transaction.transaction_id()
                                      << " by ML rule with probability: " << fraud_probability;
                     }
                 } else {
                     result.set_status(rules::RuleResult::NOT_FRAUD);
-                    LOG_INFO() << "Transaction " << request.transaction().transaction_id() 
+                    LOG_INFO() << "Transaction " << transaction.transaction_id() 
                               << " is NOT FRAUD (probability: " << fraud_probability << ")";
                 }
             }
         } else {
-            auto rule = RuleFactory::CreateRuleByType(request.rule(), history_service_, ml_detector_);
-            bool is_fraud = rule->IsFraudTransaction(request.transaction());
+            auto rule = rule_catalog_->GetOrCompile(request.rule());
+            bool is_fraud = rule->IsFraudTransaction(transaction);
             
             std::string description;
             if (request.rule().rule_type() == rules::RuleConfig::THRESHOLD) {
-                description = "Threshold rule applied, amount: " + std::to_string(request.transaction().amount());
+                description = "Threshold rule applied, amount: " + std::to_string(transaction.amount());
             } else if (request.rule().rule_type() == rules::RuleConfig::PATTERN) {
                 description = "Pattern rule applied";
             } else {
@@ -158,16 +559,16 @@ void RuleProcessor::ProcessMessage(const std::string& message) {
                 bool is_critical = request.rule().is_critical();
                 if (is_critical) {
                     result.set_status(rules::RuleResult::CRITICAL);
-                    LOG_ERROR() << "CRITICAL FRAUD detected for transaction: " << request.transaction().transaction_id()
+                    LOG_ERROR() << "CRITICAL FRAUD detected for transaction: " << transaction.transaction_id()
                                << " by rule: " << request.rule().uuid() << " (is_critical=true)";
                 } else {
                     result.set_status(rules::RuleResult::FRAUD);
-                    LOG_WARNING() << "FRAUD detected for transaction: " << request.transaction().transaction_id()
+                    LOG_WARNING() << "FRAUD detected for transaction: " << transaction.transaction_id()
                                  << " by rule: " << request.rule().uuid();
                 }
             } else {
                 result.set_status(rules::RuleResult::NOT_FRAUD);
-                LOG_INFO() << "Transaction " << request.transaction().transaction_id() 
+                LOG_INFO() << "Transaction " << transaction.transaction_id() 
                           << " is NOT FRAUD according to rule: " << request.rule().uuid();
             }
         }
@@ -177,14 +578,35 @@ void RuleProcessor::ProcessMessage(const std::string& message) {
         result.set_status(rules::RuleResult::ERROR);
         result.set_description(std::string("Error: ") + e.what());
     }
-    
-    SendResultToService(result);
 }
 
 void RuleProcessor::SendResultToService(const rules::RuleResult& result) {
     result_producer_->SendResult(result, response_topic_);
 }
 
+void RuleProcessor::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    if (history_service_) {
+        auto flights_writer = writer["history_single_flight"];
+        history_service_->WriteStatistics(flights_writer);
+    }
+    if (window_store_) {
+        auto window_writer = writer["keyed_windows"];
+        window_store_->WriteStatistics(window_writer);
+    }
+    if (rule_catalog_) {
+        auto rules_writer = writer["rules"];
+        rule_catalog_->WriteStatistics(rules_writer);
+    }
+    if (model_registry_) {
+        auto models_writer = writer["ml_models"];
+        model_registry_->WriteStatistics(models_writer);
+    }
+    if (inference_executor_) {
+        auto inference_writer = writer["inference"];
+        inference_executor_->WriteStatistics(inference_writer);
+    }
+}
+
 userver::yaml_config::Schema RuleProcessor::GetStaticConfigSchema() {
     return userver::yaml_config::impl::SchemaFromString(R"(
 type: object
@@ -199,10 +621,113 @@ properties:
         type: string
         description: Kafka topic for outgoing rule results
         defaultDescription: Response
+    account_state_shards:
+        type: integer
+        description: Number of lock shards of the in-memory account state store
+        defaultDescription: 64
+    decayed_half_lives:
+        type: array
+        description: Half-lives in seconds of the exponentially decayed per-account features
+        defaultDescription: '[3600, 86400, 2592000]'
+        items:
+            type: integer
+            description: Half-life in seconds
+    state_snapshot_path:
+        type: string
+        description: Local file for account state snapshots, empty disables snapshots
+        defaultDescription: ''
+    state_snapshot_interval:
+        type: integer
+        description: Seconds between account state snapshots
+        defaultDescription: 60
+    partition_maintenance_interval:
+        type: integer
+        description: Seconds between transaction partition maintenance runs, 0 disables it
+        defaultDescription: 3600
+    partition_days_ahead:
+        type: integer
+        description: Number of future daily transaction partitions kept precreated
+        defaultDescription: 7
+    partition_retention_days:
+        type: integer
+        description: Daily transaction partitions older than this are dropped
+        defaultDescription: 90
+    replica_reads_enabled:
+        type: boolean
+        description: Route history and aggregate reads to a replica that already shows the transactions saved by this service
+        defaultDescription: true
+    replica_max_wait_ms:
+        type: integer
+        description: Milliseconds a read waits for the replica to show the last writes of its key before reading from master
+        defaultDescription: 50
+    replica_tracked_keys:
+        type: integer
+        description: Number of keys (accounts, devices, IPs...) whose last writes replica reads wait for
+        defaultDescription: 100000
+    keyed_window_max_keys:
+        type: integer
+        description: Number of group keys (device, IP, receiver...) whose recent transactions are kept in memory
+        defaultDescription: 100000
+    keyed_window_max_events:
+        type: integer
+        description: Transactions kept per group key, older ones are aggregated by SQL
+        defaultDescription: 4096
+    keyed_window_horizon:
+        type: integer
+        description: Seconds of transactions kept per group key, longer pattern windows are aggregated by SQL
+        defaultDescription: 86400
+    keyed_window_ttl_ms:
+        type: integer
+        description: Milliseconds before a group key is reloaded to pick up other replicas' transactions
+        defaultDescription: 5000
+    aggregate_cache_max_keys:
+        type: integer
+        description: Group keys whose pattern aggregate results are cached, 0 disables the cache
+        defaultDescription: 100000
+    aggregate_cache_ttl_ms:
+        type: integer
+        description: Milliseconds a cached aggregate result may miss other replicas' writes, 0 disables the cache
+        defaultDescription: 1000
+    aggregate_cache_since_bucket:
+        type: integer
+        description: Seconds SQL aggregate window starts are rounded down to while the cache is enabled
+        defaultDescription: 10
+    batch_concurrency:
+        type: integer
+        description: Accounts of one consumer batch evaluated concurrently, 1 processes the batch sequentially
+        defaultDescription: 8
+    fs_task_processor:
+        type: string
+        description: Task processor for blocking file operations
+        defaultDescription: fs-task-processor
+    inference_task_processor:
+        type: string
+        description: Task processor that scores ML models, kept apart from the I/O coroutines
+        defaultDescription: inference-task-processor
+    inference_max_pending:
+        type: integer
+        description: Model scorings submitted to the inference task processor at once, further ones wait
+        defaultDescription: 64
+    rule_catalog_path:
+        type: string
+        description: Local file with known rule configs compiled at startup, empty disables it
+        defaultDescription: ''
+    warmup_hot_accounts:
+        type: integer
+        description: Number of most active accounts whose history is prefetched before consuming
+        defaultDescription: 0
+    warmup_predictions:
+        type: integer
+        description: Synthetic predictions run per loaded model before consuming
+        defaultDescription: 3
     ml_model_config_dir:
         type: string
         description: Directory containing ML model files
         defaultDescription: version_to_cpp_enjoyer/
+    ml_model_artifact_dir:
+        type: string
+        description: Directory with the compiled (_compiled.so) and mapped (_trees.bin) model forms
+        defaultDescription: ml_model_config_dir
 )");
 }
 
@@ -1,23 +1,38 @@
 #pragma once
 
+#include <optional>
+#include <unordered_map>
+
 #include <userver/components/component_config.hpp>
 #include <userver/components/component_context.hpp>
 #include <userver/components/loggable_component_base.hpp>
+#include <userver/components/statistics_storage.hpp>
 #include <userver/yaml_config/schema.hpp>
 #include <userver/kafka/consumer_component.hpp>
 #include <userver/kafka/producer_component.hpp>
+#include <userver/kafka/rebalance_types.hpp>
 #include <userver/storages/redis/client.hpp>
 #include <userver/clients/dns/component.hpp>
 #include <userver/clients/http/component.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/utils/statistics/storage.hpp>
 
 #include <rules/rule_request.pb.h>
 #include <rules/rule_result.pb.h>
 #include <rules/result_service.grpc.pb.h>
 #include "rule_factory/rule_factory.hpp"
 #include "transaction_history/transaction_history_service.hpp"
+#include "transaction_history/keyed_window_store.hpp"
 #include "ml_model/ml_fraud_detector.hpp"
 #include "ml_model/redis_history_provider.hpp"
+#include "ml_model/cached_history_provider.hpp"
+#include "rule_processor/batch_planner.hpp"
+#include "rule_processor/rule_catalog.hpp"
+#include "ml_model/model_registry.hpp"
 #include "rule_utils/kafka_result_producer.hpp"
+#include "account_state/account_state_store.hpp"
+#include "account_state/state_snapshot.hpp"
 
 namespace fraud_detection {
 
@@ -36,8 +51,32 @@ public:
     static userver::yaml_config::Schema GetStaticConfigSchema();
 
 private:
-    void ProcessMessage(const std::string& message);
+    void OnRebalance(
+        userver::kafka::TopicPartitionBatchView partitions,
+        userver::kafka::RebalanceEventType event);
+    void AssignPartitions(
+        const std::vector<uint32_t>& partitions,
+        const std::unordered_map<uint32_t, int64_t>& committed_offsets);
+    void Warmup(int hot_accounts, int predictions_per_model);
+    void WriteStateSnapshot();
+    void ProcessBatch(const BatchPlan& plan);
+    // Records the groups of the batch that were answered before a rewind and
+    // returns the rest, which still have to be evaluated.
+    std::vector<const TransactionGroup*> ReplayAnswered(const BatchPlan& plan);
+    void RecordTransaction(const TransactionGroup& group);
+    void ProcessTransactionGroup(const TransactionGroup& group, google::protobuf::Arena* arena);
+    // An ERROR result for every request of a group that could not be processed.
+    void SendGroupError(
+        const TransactionGroup& group,
+        google::protobuf::Arena* arena,
+        std::string_view error);
+    void EvaluateRequest(
+        const rules::RuleRequest& request,
+        const transaction::Transaction& transaction,
+        TransactionHistoryProvider* history,
+        rules::RuleResult& result);
     void SendResultToService(const rules::RuleResult& result);
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
     
     userver::kafka::ConsumerComponent& consumer_;
     userver::kafka::ProducerComponent& producer_;
@@ -50,8 +89,27 @@ private:
     std::shared_ptr<TransactionHistoryService> history_service_;
     std::shared_ptr<RedisHistoryProvider> history_provider_;
     std::unique_ptr<KafkaResultProducer> result_producer_;
-    std::shared_ptr<MLFraudDetector> ml_detector_;
+    std::shared_ptr<InferenceExecutor> inference_executor_;
+    std::shared_ptr<MLModelRegistry> model_registry_;
+    std::shared_ptr<RuleCatalog> rule_catalog_;
+    std::string rule_catalog_path_;
+    std::shared_ptr<AccountStateStore> state_store_;
+    std::shared_ptr<KeyedWindowStore> window_store_;
+    std::unique_ptr<StateSnapshotFile> snapshot_file_;
+    userver::engine::TaskProcessor& fs_task_processor_;
+    const size_t batch_concurrency_;
+    userver::utils::PeriodicTask snapshot_task_;
+    userver::utils::PeriodicTask partition_maintenance_task_;
+    // Held for a whole batch, so snapshots are taken between batches.
+    userver::engine::Mutex batch_mutex_;
+    userver::engine::Mutex restored_snapshot_mutex_;
+    std::optional<AccountStateStore::Snapshot> restored_snapshot_;
+    // Per rewound partition, the group's committed offset at assignment;
+    // requests below it were answered before and are only replayed into state.
+    userver::engine::Mutex replay_mutex_;
+    std::unordered_map<uint32_t, int64_t> replay_end_offsets_;
     std::string model_config_dir_;
+    userver::utils::statistics::Entry statistics_entry_;
 };
 
 }  // namespace fraud_detection
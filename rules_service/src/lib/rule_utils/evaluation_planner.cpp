@@ -0,0 +1,130 @@
+#include "evaluation_planner.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace rule_utils {
+
+EvaluationPlanner::EvaluationPlanner(const rules::Expression& root, const ValueCost& value_cost) {
+    PlanExpression(root, value_cost);
+}
+
+double EvaluationPlanner::PlanExpression(const rules::Expression& expr, const ValueCost& value_cost) {
+    switch (expr.expr_case()) {
+        case rules::Expression::kComparison:
+            return value_cost(expr.comparison().left()) + value_cost(expr.comparison().right());
+        case rules::Expression::kLogical:
+            break;
+        default:
+            return value_cost(expr);
+    }
+
+    const auto& logical = expr.logical();
+    const bool commutative = logical.operator_() == rules::LogicalOperation::AND ||
+                             logical.operator_() == rules::LogicalOperation::OR;
+    if (!commutative || logical.operands_size() < 2 || logical.operands_size() > static_cast<int>(kMaxPlannedOperands)) {
+        double cost = 0.0;
+        for (const auto& operand : logical.operands()) {
+            cost += PlanExpression(operand, value_cost);
+        }
+        return cost;
+    }
+
+    auto plan = std::make_unique<NodePlan>();
+    plan->is_and = logical.operator_() == rules::LogicalOperation::AND;
+    plan->name = (plan->is_and ? "and_" : "or_") + std::to_string(plan_order_.size());
+    plan_order_.push_back(plan.get());
+
+    double cost = 0.0;
+    for (const auto& operand : logical.operands()) {
+        auto stats = std::make_unique<OperandStats>();
+        stats->static_cost = PlanExpression(operand, value_cost);
+        stats->timed = stats->static_cost >= kTimedCost;
+        cost += stats->static_cost;
+        plan->operands.push_back(std::move(stats));
+    }
+    Replan(*plan);
+    plan->replans = 0;
+    plans_.emplace(&logical, std::move(plan));
+    return cost;
+}
+
+uint64_t EvaluationPlanner::PackOrder(const std::vector<size_t>& order) {
+    uint64_t packed = 0;
+    for (size_t position = 0; position < order.size(); ++position) {
+        packed |= static_cast<uint64_t>(order[position]) << (position * 4);
+    }
+    return packed;
+}
+
+double EvaluationPlanner::ObservedCost(const OperandStats& stats) {
+    constexpr uint64_t kMinTimedSamples = 16;
+    const auto evaluations = stats.evaluations.load(std::memory_order_relaxed);
+    if (!stats.timed || evaluations < kMinTimedSamples) {
+        return stats.static_cost;
+    }
+    return static_cast<double>(stats.total_ns.load(std::memory_order_relaxed)) / 1000.0 /
+           static_cast<double>(evaluations);
+}
+
+double EvaluationPlanner::ShortCircuitProbability(const OperandStats& stats, bool is_and) {
+    // Laplace smoothing: unseen operands count as a coin flip.
+    const double true_ratio =
+        (static_cast<double>(stats.true_count.load(std::memory_order_relaxed)) + 1.0) /
+        (static_cast<double>(stats.evaluations.load(std::memory_order_relaxed)) + 2.0);
+    return is_and ? 1.0 - true_ratio : true_ratio;
+}
+
+void EvaluationPlanner::Record(
+    OperandStats& stats,
+    bool value,
+    std::chrono::steady_clock::time_point started) {
+    stats.evaluations.fetch_add(1, std::memory_order_relaxed);
+    if (value) {
+        stats.true_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (stats.timed) {
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        stats.total_ns.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+            std::memory_order_relaxed);
+    }
+}
+
+void EvaluationPlanner::Replan(NodePlan& plan) {
+    std::vector<double> rank(plan.operands.size());
+    for (size_t i = 0; i < plan.operands.size(); ++i) {
+        const auto& stats = *plan.operands[i];
+        rank[i] = ObservedCost(stats) / std::max(ShortCircuitProbability(stats, plan.is_and), 1e-6);
+    }
+    std::vector<size_t> order(plan.operands.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&rank](size_t a, size_t b) { return rank[a] < rank[b]; });
+    plan.order.store(PackOrder(order), std::memory_order_relaxed);
+    plan.replans.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EvaluationPlanner::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    for (const auto* plan : plan_order_) {
+        auto node_writer = writer[plan->name];
+        node_writer["evaluations"] = plan->evaluations.load();
+        node_writer["replans"] = plan->replans.load();
+        const uint64_t order = plan->order.load();
+        for (size_t position = 0; position < plan->operands.size(); ++position) {
+            const size_t index = OperandAt(order, position);
+            const auto& stats = *plan->operands[index];
+            auto operand_writer = node_writer["operand_" + std::to_string(index)];
+            const auto evaluations = stats.evaluations.load();
+            operand_writer["position"] = static_cast<uint64_t>(position);
+            operand_writer["evaluations"] = evaluations;
+            if (evaluations > 0) {
+                operand_writer["true_ratio"] =
+                    static_cast<double>(stats.true_count.load()) / static_cast<double>(evaluations);
+            }
+            operand_writer["cost_us"] = ObservedCost(stats);
+            operand_writer["errors"] = stats.errors.load();
+        }
+    }
+}
+
+}  // namespace rule_utils
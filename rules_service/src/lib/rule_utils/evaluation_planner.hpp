@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rules/rule_config.pb.h>
+#include <userver/utils/statistics/writer.hpp>
+
+namespace rule_utils {
+
+// Chooses the order in which the operands of AND / OR nodes are evaluated.
+// Operands start ordered by a static cost estimate; as the rule runs, the
+// observed outcome of every operand and the time taken by the expensive
+// ones are recorded, and each node is periodically re-planned to evaluate
+// first the operands with the lowest cost per short-circuit:
+// cost / P(false) under AND, cost / P(true) under OR.
+// Operands must be free of side effects, as the order is not the authored one.
+// An operand that throws does not fail the node while another operand can
+// still decide it: the exception is kept and rethrown only if no operand
+// short-circuits, so reordering never turns a rule that authored order
+// decided into an error.
+class EvaluationPlanner {
+public:
+    // Rough costs in microseconds.
+    static constexpr double kFieldCost = 0.01;
+    static constexpr double kLiteralCost = 0.02;
+    static constexpr double kMemoryAggregateCost = 2.0;
+    static constexpr double kSqlAggregateCost = 1000.0;
+
+    // Static cost of a value expression: a field, literal or aggregate.
+    using ValueCost = std::function<double(const rules::Expression&)>;
+
+    EvaluationPlanner(const rules::Expression& root, const ValueCost& value_cost);
+
+    EvaluationPlanner(const EvaluationPlanner&) = delete;
+    EvaluationPlanner& operator=(const EvaluationPlanner&) = delete;
+
+    // Evaluates `logical` (AND or OR) by calling `evaluate` on its operands
+    // in planned order until the result is known.
+    template <typename EvaluateOperand>
+    bool Evaluate(const rules::LogicalOperation& logical, const EvaluateOperand& evaluate) const;
+
+    // Per node: evaluations, replans and, per authored operand, its planned
+    // position, observed true ratio, cost and errors.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    // Permutations are packed 4 bits per position into one atomic word, so
+    // nodes with more operands keep the authored order.
+    static constexpr size_t kMaxPlannedOperands = 16;
+    static constexpr uint64_t kReplanInterval = 256;
+    // Operands cheaper than this are not timed; their static cost is used.
+    static constexpr double kTimedCost = 1.0;
+
+    struct OperandStats {
+        double static_cost = 0.0;
+        bool timed = false;
+        std::atomic<uint64_t> evaluations{0};
+        std::atomic<uint64_t> true_count{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> errors{0};
+    };
+
+    struct NodePlan {
+        std::string name;
+        bool is_and = true;
+        std::vector<std::unique_ptr<OperandStats>> operands;
+        std::atomic<uint64_t> order{0};
+        std::atomic<uint64_t> evaluations{0};
+        std::atomic<uint64_t> replans{0};
+    };
+
+    double PlanExpression(const rules::Expression& expr, const ValueCost& value_cost);
+
+    static uint64_t PackOrder(const std::vector<size_t>& order);
+    static size_t OperandAt(uint64_t order, size_t position) { return (order >> (position * 4)) & 0xF; }
+    static double ObservedCost(const OperandStats& stats);
+    static double ShortCircuitProbability(const OperandStats& stats, bool is_and);
+    static void Record(OperandStats& stats, bool value, std::chrono::steady_clock::time_point started);
+    static void Replan(NodePlan& plan);
+
+    std::unordered_map<const rules::LogicalOperation*, std::unique_ptr<NodePlan>> plans_;
+    std::vector<const NodePlan*> plan_order_;
+};
+
+template <typename EvaluateOperand>
+bool EvaluationPlanner::Evaluate(const rules::LogicalOperation& logical, const EvaluateOperand& evaluate) const {
+    const bool stop_value = logical.operator_() == rules::LogicalOperation::OR;
+    auto it = plans_.find(&logical);
+    if (it == plans_.end()) {
+        for (const auto& operand : logical.operands()) {
+            if (evaluate(operand) == stop_value) {
+                return stop_value;
+            }
+        }
+        return !stop_value;
+    }
+
+    NodePlan& plan = *it->second;
+    const uint64_t order = plan.order.load(std::memory_order_relaxed);
+    bool result = !stop_value;
+    std::exception_ptr error;
+    for (size_t position = 0; position < plan.operands.size(); ++position) {
+        const size_t index = OperandAt(order, position);
+        OperandStats& stats = *plan.operands[index];
+        const auto started = stats.timed ? std::chrono::steady_clock::now()
+                                         : std::chrono::steady_clock::time_point{};
+        bool value = !stop_value;
+        try {
+            value = evaluate(logical.operands(static_cast<int>(index)));
+        } catch (const std::exception&) {
+            stats.errors.fetch_add(1, std::memory_order_relaxed);
+            if (!error) {
+                error = std::current_exception();
+            }
+            continue;
+        }
+        Record(stats, value, started);
+        if (value == stop_value) {
+            result = stop_value;
+            error = nullptr;
+            break;
+        }
+    }
+    if (++plan.evaluations % kReplanInterval == 0) {
+        Replan(plan);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
+
+}  // namespace rule_utils
@@ -0,0 +1,147 @@
+#include "aggregate_result_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <utility>
+
+namespace fraud_detection {
+
+namespace {
+
+// The columns of the transactions table aggregates are grouped by, with the
+// value `tx` has in each.
+std::array<std::pair<std::string_view, const std::string*>, 6> KeyFields(
+    const transaction::Transaction& tx) {
+    return {{
+        {"sender_account", &tx.sender_account()},
+        {"receiver_account", &tx.receiver_account()},
+        {"merchant_category", &tx.merchant_category()},
+        {"location", &tx.location()},
+        {"ip_address", &tx.ip_address()},
+        {"device_hash", &tx.device_hash()},
+    }};
+}
+
+} // anonymous namespace
+
+AggregateResultCache::AggregateResultCache(Settings settings)
+    : settings_(settings), groups_(std::max<size_t>(settings.max_keys, 1)) {}
+
+int64_t AggregateResultCache::BucketSince(int64_t since) const {
+    const int64_t bucket = std::max<int64_t>(settings_.since_bucket_seconds, 1);
+    const int64_t remainder = since % bucket;
+    return remainder < 0 ? since - remainder - bucket : since - remainder;
+}
+
+std::optional<double> AggregateResultCache::Get(
+    std::string_view column,
+    const std::string& key,
+    const std::string& query) {
+    std::lock_guard lock(mutex_);
+    auto* group = groups_.Get(GroupKey(column, key));
+    if (group && std::chrono::steady_clock::now() - group->created_at < settings_.ttl) {
+        auto it = group->results.find(query);
+        if (it != group->results.end()) {
+            ++hits_;
+            return it->second.value;
+        }
+    }
+    ++misses_;
+    return std::nullopt;
+}
+
+void AggregateResultCache::Put(
+    std::string_view column,
+    const std::string& key,
+    const std::string& query,
+    Result result,
+    uint64_t generation) {
+    std::lock_guard lock(mutex_);
+    if (generation != generations_.Get(column, key)) {
+        return;
+    }
+    const auto group_key = GroupKey(column, key);
+    const auto now = std::chrono::steady_clock::now();
+    auto* group = groups_.Get(group_key);
+    if (!group || now - group->created_at >= settings_.ttl) {
+        groups_.Put(group_key, Group{now, {}});
+        group = groups_.Get(group_key);
+    }
+    group->results[query] = result;
+}
+
+void AggregateResultCache::Apply(const transaction::Transaction& tx) {
+    int64_t timestamp = 0;
+    try {
+        timestamp = std::stoll(tx.timestamp());
+    } catch (const std::exception&) {
+        Invalidate(tx);
+        return;
+    }
+
+    std::lock_guard lock(mutex_);
+    generations_.Bump(tx);
+    for (const auto& [column, key] : KeyFields(tx)) {
+        if (key->empty()) {
+            continue;
+        }
+        auto* group = groups_.Get(GroupKey(column, *key));
+        if (!group) {
+            continue;
+        }
+        auto& results = group->results;
+        for (auto it = results.begin(); it != results.end();) {
+            auto& result = it->second;
+            if (timestamp < result.since) {
+                ++it;
+                continue;
+            }
+            switch (result.update) {
+                case AggregateUpdate::kCount: result.value += 1.0; break;
+                case AggregateUpdate::kSumAmount: result.value += tx.amount(); break;
+                case AggregateUpdate::kNone:
+                    it = results.erase(it);
+                    ++invalidations_;
+                    continue;
+            }
+            ++patches_;
+            ++it;
+        }
+    }
+}
+
+void AggregateResultCache::Invalidate(const transaction::Transaction& tx) {
+    std::lock_guard lock(mutex_);
+    generations_.Bump(tx);
+    for (const auto& [column, key] : KeyFields(tx)) {
+        if (key->empty()) {
+            continue;
+        }
+        const auto group_key = GroupKey(column, *key);
+        if (groups_.Get(group_key)) {
+            groups_.Erase(group_key);
+            ++invalidations_;
+        }
+    }
+}
+
+void AggregateResultCache::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    writer["hits"] = hits_.load();
+    writer["misses"] = misses_.load();
+    writer["invalidations"] = invalidations_.load();
+    writer["patches"] = patches_.load();
+    std::lock_guard lock(mutex_);
+    writer["keys"] = static_cast<uint64_t>(groups_.GetSize());
+}
+
+std::string AggregateResultCache::GroupKey(std::string_view column, std::string_view key) {
+    std::string group_key;
+    group_key.reserve(column.size() + key.size() + 1);
+    group_key.append(column);
+    group_key.push_back('\x1f');
+    group_key.append(key);
+    return group_key;
+}
+
+} // namespace fraud_detection
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+#include <transaction/transaction.pb.h>
+
+#include "transaction_history/write_generations.hpp"
+
+namespace fraud_detection {
+
+// How a cached aggregate follows a transaction saved into its window.
+enum class AggregateUpdate : uint8_t {
+    kNone,       // dropped and reloaded on next use
+    kCount,      // COUNT(*) without a row limit
+    kSumAmount,  // SUM(amount) without a row limit
+};
+
+// Results of pattern aggregate queries, grouped by the column and key the
+// aggregate is computed over (the sender account, or a receiver, device hash
+// and so on for grouped aggregates). A transaction saved by this replica
+// patches the counts and sums of its groups and drops their other results;
+// the TTL bounds how long writes of other replicas go unseen.
+class AggregateResultCache {
+public:
+    struct Settings {
+        // Group keys kept, least recently used are evicted.
+        size_t max_keys = 100000;
+        std::chrono::milliseconds ttl{1000};
+        // Window starts are rounded down to this many seconds, so the
+        // transactions of one sender share results between them.
+        int64_t since_bucket_seconds = 10;
+    };
+
+    struct Result {
+        double value = 0.0;
+        int64_t since = 0;
+        AggregateUpdate update = AggregateUpdate::kNone;
+    };
+
+    explicit AggregateResultCache(Settings settings);
+
+    // Write generation of the group key to pass to Put: results loaded while
+    // a transaction of that key was being saved are not cached.
+    uint64_t Generation(std::string_view column, std::string_view key) const {
+        return generations_.Get(column, key);
+    }
+
+    // The window start aggregates are queried and cached with.
+    int64_t BucketSince(int64_t since) const;
+
+    // `query` identifies the aggregate within the group: its statement, the
+    // window start and the row limit.
+    std::optional<double> Get(std::string_view column, const std::string& key, const std::string& query);
+    void Put(
+        std::string_view column,
+        const std::string& key,
+        const std::string& query,
+        Result result,
+        uint64_t generation);
+
+    // Adds a transaction that was just inserted to the groups of every key
+    // field of `tx`.
+    void Apply(const transaction::Transaction& tx);
+    // Drops the groups of every key field of `tx`, for transactions Apply
+    // cannot place in a window.
+    void Invalidate(const transaction::Transaction& tx);
+
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    struct Group {
+        std::chrono::steady_clock::time_point created_at;
+        std::unordered_map<std::string, Result> results;
+    };
+
+    static std::string GroupKey(std::string_view column, std::string_view key);
+
+    const Settings settings_;
+
+    mutable userver::engine::Mutex mutex_;
+    userver::cache::LruMap<std::string, Group> groups_;
+    WriteGenerations generations_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+    std::atomic<uint64_t> patches_{0};
+};
+
+} // namespace fraud_detection
@@ -0,0 +1,30 @@
+#include "history_columns.hpp"
+
+namespace fraud_detection {
+
+void HistoryColumns::Reserve(size_t rows) {
+    timestamps.reserve(rows);
+    amounts.reserve(rows);
+    location_ids.reserve(rows);
+}
+
+void HistoryColumns::Append(int64_t timestamp, float amount, std::string_view location) {
+    auto [it, inserted] = location_index_.try_emplace(
+        std::string(location), static_cast<uint32_t>(locations.size()));
+    if (inserted) {
+        locations.push_back(it->first);
+    }
+    timestamps.push_back(timestamp);
+    amounts.push_back(amount);
+    location_ids.push_back(it->second);
+}
+
+std::optional<uint32_t> HistoryColumns::FindLocation(std::string_view location) const {
+    auto it = location_index_.find(std::string(location));
+    if (it == location_index_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+} // namespace fraud_detection
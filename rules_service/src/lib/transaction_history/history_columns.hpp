@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fraud_detection {
+
+// Account history in columns, holding only what the ML account stats read:
+// row i is (timestamps[i], amounts[i], locations[location_ids[i]]).
+// Locations are interned per block, so a row costs 16 bytes instead of a
+// Transaction proto with a dozen heap-allocated strings.
+struct HistoryColumns {
+    std::vector<int64_t> timestamps;
+    std::vector<float> amounts;
+    std::vector<uint32_t> location_ids;
+    std::vector<std::string> locations;
+
+    size_t Size() const { return timestamps.size(); }
+    bool Empty() const { return timestamps.empty(); }
+
+    void Reserve(size_t rows);
+    void Append(int64_t timestamp, float amount, std::string_view location);
+
+    // Id of `location` in this block, std::nullopt if no row has it.
+    std::optional<uint32_t> FindLocation(std::string_view location) const;
+
+private:
+    std::unordered_map<std::string, uint32_t> location_index_;
+};
+
+} // namespace fraud_detection
@@ -0,0 +1,224 @@
+#include "keyed_window_store.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
+
+#include <userver/logging/log.hpp>
+
+namespace fraud_detection {
+
+KeyedWindowStore::KeyedWindowStore(
+    std::shared_ptr<TransactionHistoryService> history_service,
+    Settings settings)
+    : history_service_(std::move(history_service)),
+      settings_(settings),
+      entries_(std::max<size_t>(settings.max_keys, 1)) {}
+
+const char* KeyedWindowStore::ColumnName(WindowField field) {
+    switch (field) {
+        case WindowField::kSenderAccount: return "sender_account";
+        case WindowField::kReceiverAccount: return "receiver_account";
+        case WindowField::kMerchantCategory: return "merchant_category";
+        case WindowField::kLocation: return "location";
+        case WindowField::kIpAddress: return "ip_address";
+        case WindowField::kDeviceHash: return "device_hash";
+    }
+    return "sender_account";
+}
+
+std::string_view KeyedWindowStore::FieldValue(const transaction::Transaction& tx, WindowField field) {
+    switch (field) {
+        case WindowField::kSenderAccount: return tx.sender_account();
+        case WindowField::kReceiverAccount: return tx.receiver_account();
+        case WindowField::kMerchantCategory: return tx.merchant_category();
+        case WindowField::kLocation: return tx.location();
+        case WindowField::kIpAddress: return tx.ip_address();
+        case WindowField::kDeviceHash: return tx.device_hash();
+    }
+    return {};
+}
+
+std::optional<double> KeyedWindowStore::Aggregate(
+    WindowField key_field,
+    const std::string& key,
+    int64_t since,
+    WindowFunction function,
+    WindowField distinct_field) {
+    const auto map_key = MakeKey(key_field, key);
+
+    auto compute = [&](const Entry& entry) -> std::optional<double> {
+        if (since < entry.covered_since) {
+            return std::nullopt;
+        }
+        auto it = std::lower_bound(
+            entry.events.begin(), entry.events.end(), since,
+            [](const Event& event, int64_t ts) { return event.timestamp < ts; });
+
+        int64_t count = 0;
+        double sum = 0.0;
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+        std::unordered_set<uint64_t> distinct;
+        for (; it != entry.events.end(); ++it) {
+            ++count;
+            sum += it->amount;
+            min = std::min(min, it->amount);
+            max = std::max(max, it->amount);
+            if (function == WindowFunction::kCountDistinct) {
+                distinct.insert(it->field_hashes[static_cast<size_t>(distinct_field)]);
+            }
+        }
+
+        switch (function) {
+            case WindowFunction::kCount: return static_cast<double>(count);
+            case WindowFunction::kSum: return sum;
+            case WindowFunction::kAvg: return count > 0 ? sum / count : 0.0;
+            case WindowFunction::kMin: return count > 0 ? min : 0.0;
+            case WindowFunction::kMax: return count > 0 ? max : 0.0;
+            case WindowFunction::kCountDistinct: return static_cast<double>(distinct.size());
+        }
+        return std::nullopt;
+    };
+
+    int64_t load_since = since;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto* entry = entries_.Get(map_key)) {
+            if (std::chrono::steady_clock::now() - entry->loaded_at < settings_.ttl) {
+                if (auto result = compute(*entry)) {
+                    ++hits_;
+                    return result;
+                }
+                if (entry->truncated) {
+                    ++fallbacks_;
+                    return std::nullopt;
+                }
+            }
+            load_since = std::min(since, entry->covered_since);
+        }
+    }
+
+    auto loaded = Load(key_field, key, load_since);
+    if (!loaded) {
+        ++fallbacks_;
+        return std::nullopt;
+    }
+    ++loads_;
+
+    std::lock_guard lock(mutex_);
+    auto result = compute(*loaded);
+    if (!result) {
+        ++fallbacks_;
+    }
+    entries_.Put(map_key, std::move(*loaded));
+    return result;
+}
+
+void KeyedWindowStore::Append(const std::vector<transaction::Transaction>& transactions) {
+    std::lock_guard lock(mutex_);
+    for (const auto& tx : transactions) {
+        int64_t timestamp = 0;
+        try {
+            timestamp = std::stoll(tx.timestamp());
+        } catch (const std::exception&) {
+            continue;
+        }
+        const auto event = MakeEvent(tx, timestamp);
+        for (size_t i = 0; i < kWindowFieldCount; ++i) {
+            const auto field = static_cast<WindowField>(i);
+            if (auto* entry = entries_.Get(MakeKey(field, FieldValue(tx, field)))) {
+                Insert(*entry, event);
+            }
+        }
+    }
+}
+
+void KeyedWindowStore::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    {
+        std::lock_guard lock(mutex_);
+        writer["keys"] = static_cast<uint64_t>(entries_.GetSize());
+    }
+    writer["hits"] = hits_.load();
+    writer["loads"] = loads_.load();
+    writer["fallbacks"] = fallbacks_.load();
+}
+
+KeyedWindowStore::Event KeyedWindowStore::MakeEvent(
+    const transaction::Transaction& tx,
+    int64_t timestamp) {
+    Event event;
+    event.timestamp = timestamp;
+    event.amount = tx.amount();
+    event.transaction_hash = std::hash<std::string_view>{}(tx.transaction_id());
+    for (size_t i = 0; i < kWindowFieldCount; ++i) {
+        event.field_hashes[i] =
+            std::hash<std::string_view>{}(FieldValue(tx, static_cast<WindowField>(i)));
+    }
+    return event;
+}
+
+std::string KeyedWindowStore::MakeKey(WindowField field, std::string_view value) {
+    std::string key;
+    key.reserve(value.size() + 1);
+    key.push_back(static_cast<char>('0' + static_cast<int>(field)));
+    key.append(value);
+    return key;
+}
+
+std::optional<KeyedWindowStore::Entry> KeyedWindowStore::Load(
+    WindowField key_field,
+    const std::string& key,
+    int64_t since) const {
+    if (!history_service_) {
+        return std::nullopt;
+    }
+    auto rows = history_service_->GetTransactionsByKey(
+        ColumnName(key_field), key, since, settings_.max_events_per_key + 1);
+    if (!rows) {
+        return std::nullopt;
+    }
+
+    Entry entry;
+    entry.covered_since = since;
+    entry.loaded_at = std::chrono::steady_clock::now();
+    for (const auto& tx : *rows) {
+        try {
+            Insert(entry, MakeEvent(tx, std::stoll(tx.timestamp())));
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    LOG_DEBUG() << "Loaded " << entry.events.size() << " transactions for "
+                << ColumnName(key_field) << " window since " << since;
+    return entry;
+}
+
+void KeyedWindowStore::Insert(Entry& entry, Event event) const {
+    auto& events = entry.events;
+    auto pos = std::upper_bound(
+        events.begin(), events.end(), event.timestamp,
+        [](int64_t ts, const Event& other) { return ts < other.timestamp; });
+    for (auto it = pos; it != events.begin() && std::prev(it)->timestamp == event.timestamp; --it) {
+        if (std::prev(it)->transaction_hash == event.transaction_hash) {
+            return;
+        }
+    }
+    events.insert(pos, event);
+
+    const int64_t horizon_start = events.back().timestamp - settings_.horizon_seconds;
+    while (!events.empty() && events.front().timestamp < horizon_start) {
+        events.pop_front();
+    }
+    entry.covered_since = std::max(entry.covered_since, horizon_start);
+
+    while (events.size() > settings_.max_events_per_key) {
+        entry.covered_since = std::max(entry.covered_since, events.front().timestamp + 1);
+        entry.truncated = true;
+        events.pop_front();
+    }
+}
+
+}  // namespace fraud_detection
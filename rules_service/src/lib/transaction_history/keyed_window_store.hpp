@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+#include <transaction/transaction.pb.h>
+
+#include "transaction_history/transaction_history_service.hpp"
+
+namespace fraud_detection {
+
+// Transaction fields a keyed window can be grouped by or count distinct values of.
+enum class WindowField : uint8_t {
+    kSenderAccount = 0,
+    kReceiverAccount,
+    kMerchantCategory,
+    kLocation,
+    kIpAddress,
+    kDeviceHash,
+};
+
+inline constexpr size_t kWindowFieldCount = 6;
+
+enum class WindowFunction : uint8_t {
+    kCount,
+    kSum,
+    kAvg,
+    kMin,
+    kMax,
+    kCountDistinct,
+};
+
+// Recent transactions grouped by a field other than the sender, e.g. every
+// transaction from one device_hash across all accounts. Requests are
+// partitioned by sender, so other replicas write most of a key's
+// transactions: a key is loaded from Postgres on first use and reloaded once
+// it is older than the TTL, and this replica's own saves are appended in
+// between. A load reads at most max_events_per_key + 1 rows; a key with more
+// is too hot to keep whole and serves its longer windows from SQL until the
+// TTL expires. Keys are evicted in LRU order beyond max_keys.
+class KeyedWindowStore {
+public:
+    struct Settings {
+        size_t max_keys = 100000;
+        size_t max_events_per_key = 4096;
+        // Longest window served from memory; longer windows go to SQL.
+        int64_t horizon_seconds = 24 * 3600;
+        std::chrono::milliseconds ttl{5000};
+    };
+
+    KeyedWindowStore(std::shared_ptr<TransactionHistoryService> history_service, Settings settings);
+
+    static const char* ColumnName(WindowField field);
+    static std::string_view FieldValue(const transaction::Transaction& tx, WindowField field);
+
+    // Aggregates the amount (or counts distinct values of `distinct_field`) of
+    // the transactions with `key_field` == `key` since `since`. std::nullopt
+    // when the window is longer than the horizon or the key could not be loaded.
+    std::optional<double> Aggregate(
+        WindowField key_field,
+        const std::string& key,
+        int64_t since,
+        WindowFunction function,
+        WindowField distinct_field = WindowField::kSenderAccount);
+
+    // Appends transactions saved by this replica to the keys already loaded.
+    void Append(const std::vector<transaction::Transaction>& transactions);
+
+    int64_t GetHorizon() const { return settings_.horizon_seconds; }
+
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    struct Event {
+        int64_t timestamp = 0;
+        double amount = 0.0;
+        uint64_t transaction_hash = 0;
+        std::array<uint64_t, kWindowFieldCount> field_hashes{};
+    };
+
+    struct Entry {
+        std::deque<Event> events;  // ordered by timestamp
+        // Events are complete from this timestamp on.
+        int64_t covered_since = 0;
+        // Older events were dropped for max_events_per_key, so windows
+        // before covered_since are not worth reloading until the TTL expires.
+        bool truncated = false;
+        std::chrono::steady_clock::time_point loaded_at;
+    };
+
+    static Event MakeEvent(const transaction::Transaction& tx, int64_t timestamp);
+    static std::string MakeKey(WindowField field, std::string_view value);
+
+    std::optional<Entry> Load(WindowField key_field, const std::string& key, int64_t since) const;
+    void Insert(Entry& entry, Event event) const;
+
+    std::shared_ptr<TransactionHistoryService> history_service_;
+    const Settings settings_;
+
+    mutable userver::engine::Mutex mutex_;
+    userver::cache::LruMap<std::string, Entry> entries_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> loads_{0};
+    std::atomic<uint64_t> fallbacks_{0};
+};
+
+}  // namespace fraud_detection
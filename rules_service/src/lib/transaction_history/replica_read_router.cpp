@@ -0,0 +1,132 @@
+#include "replica_read_router.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+#include <userver/engine/sleep.hpp>
+
+namespace fraud_detection {
+
+namespace {
+
+// How many of the writes the replica shows, and how far behind the master its
+// replay is: the age of the last replayed commit, 0 when the host is the
+// master itself.
+const std::string kVisibleWritesSql =
+    "SELECT COUNT(DISTINCT transaction_id)::bigint, "
+    "COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000, 0)::bigint "
+    "FROM transactions "
+    "WHERE transaction_id = ANY($1) AND times_tamp BETWEEN to_timestamp($2) AND to_timestamp($3)";
+
+}  // namespace
+
+ReplicaReadRouter::ReplicaReadRouter(
+    userver::storages::postgres::ClusterPtr pg_cluster,
+    Settings settings)
+    : pg_cluster_(std::move(pg_cluster)),
+      settings_(settings),
+      writes_(std::max<size_t>(settings.max_keys, 1)) {}
+
+void ReplicaReadRouter::OnSaved(const transaction::Transaction& tx) {
+    if (!settings_.enabled) {
+        return;
+    }
+    Write write{tx.transaction_id(), 0};
+    try {
+        write.timestamp = std::stoll(tx.timestamp());
+    } catch (const std::exception&) {
+        return;
+    }
+
+    std::lock_guard lock(mutex_);
+    for (const auto& [column, key] : {
+             std::pair<std::string_view, std::string_view>{"sender_account", tx.sender_account()},
+             {"receiver_account", tx.receiver_account()},
+             {"merchant_category", tx.merchant_category()},
+             {"location", tx.location()},
+             {"ip_address", tx.ip_address()},
+             {"device_hash", tx.device_hash()}}) {
+        if (key.empty()) {
+            continue;
+        }
+        const auto write_key = WriteKey(column, key);
+        auto* writes = writes_.Get(write_key);
+        if (!writes) {
+            writes = writes_.Emplace(write_key, {});
+        }
+        const bool known = std::any_of(writes->begin(), writes->end(), [&write](const Write& other) {
+            return other.transaction_id == write.transaction_id;
+        });
+        if (known) {
+            continue;
+        }
+        if (writes->size() == kWritesPerKey) {
+            writes->erase(writes->begin());
+        }
+        writes->push_back(write);
+    }
+}
+
+std::vector<ReplicaReadRouter::Write> ReplicaReadRouter::RecentWrites(
+    std::string_view column,
+    const std::string& key) const {
+    std::lock_guard lock(mutex_);
+    const auto* writes = writes_.Get(WriteKey(column, key));
+    return writes ? *writes : std::vector<Write>{};
+}
+
+bool ReplicaReadRouter::WaitForWrites(
+    userver::storages::postgres::Transaction& trx,
+    const std::vector<Write>& writes) {
+    std::vector<std::string> ids;
+    ids.reserve(writes.size());
+    int64_t min_timestamp = writes.front().timestamp;
+    int64_t max_timestamp = writes.front().timestamp;
+    for (const auto& write : writes) {
+        ids.push_back(write.transaction_id);
+        min_timestamp = std::min(min_timestamp, write.timestamp);
+        max_timestamp = std::max(max_timestamp, write.timestamp);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + settings_.max_wait;
+    bool waited = false;
+    while (true) {
+        auto result = trx.Execute(kVisibleWritesSql, ids, min_timestamp, max_timestamp);
+        const auto row = result[0];
+        lag_ms_ = row[1].As<int64_t>();
+        const bool visible = row[0].As<int64_t>() >= static_cast<int64_t>(ids.size());
+        if (visible || std::chrono::steady_clock::now() + settings_.poll_interval > deadline) {
+            last_wait_us_ = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started).count();
+            if (waited) {
+                ++replica_waits_;
+            }
+            return visible;
+        }
+        waited = true;
+        userver::engine::SleepFor(settings_.poll_interval);
+    }
+}
+
+void ReplicaReadRouter::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    writer["replica_reads"] = replica_reads_.load();
+    writer["replica_waits"] = replica_waits_.load();
+    writer["master_fallbacks"] = master_fallbacks_.load();
+    writer["replica_errors"] = replica_errors_.load();
+    writer["lag_ms"] = lag_ms_.load();
+    writer["last_wait_us"] = last_wait_us_.load();
+    std::lock_guard lock(mutex_);
+    writer["tracked_keys"] = static_cast<uint64_t>(writes_.GetSize());
+}
+
+std::string ReplicaReadRouter::WriteKey(std::string_view column, std::string_view key) {
+    std::string write_key;
+    write_key.reserve(column.size() + key.size() + 1);
+    write_key.append(column);
+    write_key.push_back('\x1f');
+    write_key.append(key);
+    return write_key;
+}
+
+}  // namespace fraud_detection
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/transaction.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+#include <transaction/transaction.pb.h>
+
+namespace fraud_detection {
+
+// Sends history and aggregate reads to a replica without losing the writes
+// they must see. Every transaction saved here is remembered under each of its
+// key fields; a read of a key with remembered writes opens a read-only
+// transaction on a replica, waits up to max_wait until that replica shows
+// those writes, and then runs on the same connection. Reads of keys without
+// recent writes go to a replica directly, and reads whose writes are still
+// missing after max_wait fall back to the master.
+//
+// A lane saves its transaction before evaluating it, so the writes of the
+// sender account always include the transaction being evaluated. Keys shared
+// between accounts (receiver, device hash...) keep their last kWritesPerKey
+// writes.
+class ReplicaReadRouter {
+public:
+    struct Settings {
+        bool enabled = true;
+        std::chrono::milliseconds max_wait{50};
+        std::chrono::milliseconds poll_interval{2};
+        // Keys whose recent writes are remembered, least recently written
+        // are forgotten.
+        size_t max_keys = 100000;
+    };
+
+    ReplicaReadRouter(userver::storages::postgres::ClusterPtr pg_cluster, Settings settings);
+
+    // Remembers a transaction that is committed on the master.
+    void OnSaved(const transaction::Transaction& tx);
+
+    // Runs a read of the rows whose `column` equals `key` on a replica that
+    // shows every remembered write of the key, or on the master.
+    template <typename... Args>
+    userver::storages::postgres::ResultSet Execute(
+        std::string_view column,
+        const std::string& key,
+        const userver::storages::postgres::Query& query,
+        const Args&... args);
+
+    // Replica and master reads, reads that waited for the replica, the
+    // replica lag seen by the last wait and the time it took.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
+
+private:
+    static constexpr size_t kWritesPerKey = 4;
+
+    struct Write {
+        std::string transaction_id;
+        int64_t timestamp = 0;
+    };
+
+    std::vector<Write> RecentWrites(std::string_view column, const std::string& key) const;
+    // Polls the replica behind `trx` until it shows `writes` or max_wait
+    // expires. Throws on query errors.
+    bool WaitForWrites(userver::storages::postgres::Transaction& trx, const std::vector<Write>& writes);
+
+    static std::string WriteKey(std::string_view column, std::string_view key);
+
+    userver::storages::postgres::ClusterPtr pg_cluster_;
+    const Settings settings_;
+
+    mutable userver::engine::Mutex mutex_;
+    mutable userver::cache::LruMap<std::string, std::vector<Write>> writes_;
+
+    std::atomic<uint64_t> replica_reads_{0};
+    std::atomic<uint64_t> replica_waits_{0};
+    std::atomic<uint64_t> master_fallbacks_{0};
+    std::atomic<uint64_t> replica_errors_{0};
+    std::atomic<int64_t> lag_ms_{0};
+    std::atomic<int64_t> last_wait_us_{0};
+};
+
+template <typename... Args>
+userver::storages::postgres::ResultSet ReplicaReadRouter::Execute(
+    std::string_view column,
+    const std::string& key,
+    const userver::storages::postgres::Query& query,
+    const Args&... args) {
+    using userver::storages::postgres::ClusterHostType;
+    using userver::storages::postgres::TransactionOptions;
+
+    if (settings_.enabled) {
+        try {
+            const auto writes = RecentWrites(column, key);
+            if (writes.empty()) {
+                auto result = pg_cluster_->Execute(ClusterHostType::kSlave, query, args...);
+                ++replica_reads_;
+                return result;
+            }
+            // The wait and the read share one connection, so they hit the
+            // same replica.
+            auto trx = pg_cluster_->Begin(
+                ClusterHostType::kSlave, TransactionOptions{TransactionOptions::kReadOnly});
+            if (WaitForWrites(trx, writes)) {
+                auto result = trx.Execute(query, args...);
+                trx.Commit();
+                ++replica_reads_;
+                return result;
+            }
+            trx.Rollback();
+            ++master_fallbacks_;
+            LOG_DEBUG() << "Replica does not show the last writes of " << column << ' ' << key
+                        << " yet, reading from master";
+        } catch (const std::exception& e) {
+            ++replica_errors_;
+            LOG_WARNING() << "Replica read failed, reading from master: " << e.what();
+        }
+    }
+    return pg_cluster_->Execute(ClusterHostType::kMaster, query, args...);
+}
+
+}  // namespace fraud_detection
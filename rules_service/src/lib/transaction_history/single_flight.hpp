@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/task/shared_task_with_result.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+namespace fraud_detection {
+
+// Coalesces concurrent identical reads: the first caller for a key runs the
+// loader in a shared task, callers arriving while it is in flight wait for
+// that task instead of issuing their own query, and all get its result.
+// Nothing is cached once the task finishes.
+template <typename Value>
+class SingleFlight {
+public:
+    // `load` runs detached from the caller's stack, so it must own
+    // everything it uses.
+    template <typename Load>
+    Value Run(const std::string& key, Load&& load) {
+        ++calls_;
+        userver::engine::SharedTaskWithResult<Value> task;
+        bool leader = false;
+        {
+            std::lock_guard lock(mutex_);
+            auto [it, inserted] = in_flight_.try_emplace(key);
+            if (inserted) {
+                it->second = userver::engine::SharedAsyncNoSpan(std::forward<Load>(load));
+                leader = true;
+            }
+            task = it->second;
+        }
+        if (!leader) {
+            return task.Get();
+        }
+
+        // The leader retires the key, also when it is cancelled while
+        // waiting; followers keep their own handle to the task.
+        try {
+            Value value = task.Get();
+            Retire(key);
+            return value;
+        } catch (...) {
+            Retire(key);
+            throw;
+        }
+    }
+
+    // calls and executed queries; coalesced calls are the difference.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const {
+        const auto calls = calls_.load();
+        const auto executed = executed_.load();
+        writer["calls"] = calls;
+        writer["executed"] = executed;
+        writer["coalesced"] = calls - executed;
+        if (calls > 0) {
+            writer["coalescing_ratio"] = static_cast<double>(calls - executed) / static_cast<double>(calls);
+        }
+    }
+
+private:
+    void Retire(const std::string& key) {
+        ++executed_;
+        std::lock_guard lock(mutex_);
+        in_flight_.erase(key);
+    }
+
+    userver::engine::Mutex mutex_;
+    std::unordered_map<std::string, userver::engine::SharedTaskWithResult<Value>> in_flight_;
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> executed_{0};
+};
+
+} // namespace fraud_detection
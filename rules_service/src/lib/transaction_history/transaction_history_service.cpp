@@ -1,13 +1,63 @@
 #include "transaction_history_service.hpp"
 
+#include <algorithm>
+#include <type_traits>
+
 #include <userver/logging/log.hpp>
 #include <userver/storages/postgres/component.hpp>
+#include <userver/storages/postgres/io/chrono.hpp>
 
 namespace fraud_detection {
 
+namespace {
+
+// Single-flight key of a read, with the write generation of the key it reads.
+// Reads issued after a save of that key never join a query that may have
+// started before it.
+template <typename... Args>
+std::string FlightKey(uint64_t write_generation, const Args&... args) {
+    std::string key = std::to_string(write_generation);
+    auto append = [&key](const auto& arg) {
+        key += '\x1f';
+        if constexpr (std::is_convertible_v<decltype(arg), std::string_view>) {
+            key += arg;
+        } else {
+            key += std::to_string(arg);
+        }
+    };
+    (append(args), ...);
+    return key;
+}
+
+// Folds the rows returned by the `inserted` CTE into one rollup table, so that
+// transactions skipped by ON CONFLICT are never counted twice.
+std::string RollupUpsert(const std::string& table, const std::string& bucket) {
+    return "INSERT INTO " + table + " "
+           "(sender_account, bucket_start, tx_count, amount_sum, amount_min, amount_max) "
+           "SELECT sender_account, date_trunc('" + bucket + "', times_tamp), "
+           "COUNT(*), SUM(amount), MIN(amount), MAX(amount) "
+           "FROM inserted GROUP BY 1, 2 "
+           "ON CONFLICT (sender_account, bucket_start) DO UPDATE SET "
+           "tx_count = " + table + ".tx_count + EXCLUDED.tx_count, "
+           "amount_sum = " + table + ".amount_sum + EXCLUDED.amount_sum, "
+           "amount_min = LEAST(" + table + ".amount_min, EXCLUDED.amount_min), "
+           "amount_max = GREATEST(" + table + ".amount_max, EXCLUDED.amount_max)";
+}
+
+// Appended to a `WITH inserted AS (INSERT ... RETURNING ...)` statement.
+const std::string kUpdateRollups =
+    ", minute_rollup AS (" + RollupUpsert("transaction_rollups_minute", "minute") + ") " +
+    RollupUpsert("transaction_rollups_hour", "hour");
+
+}  // namespace
+
 TransactionHistoryService::TransactionHistoryService(
-    userver::storages::postgres::ClusterPtr pg_cluster)
-    : pg_cluster_(std::move(pg_cluster)) {}
+    userver::storages::postgres::ClusterPtr pg_cluster,
+    std::shared_ptr<ReplicaReadRouter> read_router,
+    std::shared_ptr<AggregateResultCache> aggregate_cache)
+    : pg_cluster_(std::move(pg_cluster)),
+      read_router_(std::move(read_router)),
+      aggregate_cache_(std::move(aggregate_cache)) {}
 
 void TransactionHistoryService::SaveTransaction(
     const transaction::Transaction& tx) {
@@ -15,15 +65,19 @@ void TransactionHistoryService::SaveTransaction(
         LOG_DEBUG() << "SaveTransaction: executing INSERT for transaction: " << tx.transaction_id()
                     << " account: " << tx.sender_account();
 
-        auto result = pg_cluster_->Execute(
-            userver::storages::postgres::ClusterHostType::kMaster,
-            "INSERT INTO transactions "
+        static const std::string kInsertSql =
+            "WITH inserted AS (INSERT INTO transactions "
             "(transaction_id, sender_account, times_tamp, receiver_account, amount, "
             "transaction_type, merchant_category, location, device_used, payment_channel, "
             "ip_address, device_hash) "
             "VALUES ($1, $2, to_timestamp($3), $4, $5, $6::transaction_type, $7, $8, "
             "$9::device_used, $10::payment_channel, $11, $12) "
-            "ON CONFLICT (transaction_id) DO NOTHING",
+            "ON CONFLICT (transaction_id, times_tamp) DO NOTHING "
+            "RETURNING sender_account, times_tamp, amount)" + kUpdateRollups;
+
+        auto result = pg_cluster_->Execute(
+            userver::storages::postgres::ClusterHostType::kMaster,
+            kInsertSql,
             tx.transaction_id(),
             tx.sender_account(),
             std::stoll(tx.timestamp()),
@@ -38,6 +92,21 @@ void TransactionHistoryService::SaveTransaction(
             tx.device_hash()
         );
         
+        // Committed either way, so replica reads of its keys wait for it.
+        if (read_router_) {
+            read_router_->OnSaved(tx);
+        }
+        // The statement ends with the hour rollup upsert, which touches a row
+        // only when the transaction itself was inserted.
+        if (result.RowsAffected() == 0) {
+            LOG_DEBUG() << "Transaction " << tx.transaction_id() << " is already saved";
+            return;
+        }
+
+        write_generations_.Bump(tx);
+        if (aggregate_cache_) {
+            aggregate_cache_->Apply(tx);
+        }
         LOG_INFO() << "Saved transaction " << tx.transaction_id() 
                    << " to PostgreSQL for account " << tx.sender_account();
     } catch (const std::exception& e) {
@@ -47,12 +116,21 @@ void TransactionHistoryService::SaveTransaction(
 
 std::vector<transaction::Transaction> 
 TransactionHistoryService::GetAccountHistory(
+    const std::string& account_id, 
+    int limit) const {
+    return account_history_flights_.Run(
+        FlightKey(write_generations_.Get("sender_account", account_id), account_id, limit),
+        [this, account_id, limit] { return FetchAccountHistory(account_id, limit); });
+}
+
+std::vector<transaction::Transaction> 
+TransactionHistoryService::FetchAccountHistory(
     const std::string& account_id, 
     int limit) const {
     std::vector<transaction::Transaction> history;
     try {
-        auto result = pg_cluster_->Execute(
-            userver::storages::postgres::ClusterHostType::kSlave,
+        auto result = ExecuteRead(
+            "sender_account", account_id,
             "SELECT transaction_id, sender_account, EXTRACT(EPOCH FROM times_tamp)::bigint as timestamp, "
             "receiver_account, amount::double precision as amount, transaction_type::text, merchant_category, location, "
             "device_used::text, payment_channel::text, ip_address, device_hash "
@@ -91,6 +169,45 @@ TransactionHistoryService::GetAccountHistory(
     return history;
 }
 
+HistoryColumns TransactionHistoryService::GetAccountHistoryColumns(
+    const std::string& account_id,
+    int64_t before_timestamp,
+    int limit) const {
+    return history_columns_flights_.Run(
+        FlightKey(write_generations_.Get("sender_account", account_id), account_id, before_timestamp, limit),
+        [this, account_id, before_timestamp, limit] {
+            return FetchAccountHistoryColumns(account_id, before_timestamp, limit);
+        });
+}
+
+HistoryColumns TransactionHistoryService::FetchAccountHistoryColumns(
+    const std::string& account_id,
+    int64_t before_timestamp,
+    int limit) const {
+    HistoryColumns columns;
+    try {
+        auto result = ExecuteRead(
+            "sender_account", account_id,
+            "SELECT EXTRACT(EPOCH FROM times_tamp)::bigint, amount::real, location "
+            "FROM transactions "
+            "WHERE sender_account = $1 AND times_tamp < to_timestamp($2) "
+            "ORDER BY times_tamp DESC "
+            "LIMIT $3",
+            account_id,
+            before_timestamp,
+            limit
+        );
+        columns.Reserve(result.Size());
+        for (const auto& row : result) {
+            columns.Append(row[0].As<int64_t>(), row[1].As<float>(), row[2].As<std::string>());
+        }
+        LOG_DEBUG() << "Retrieved " << columns.Size() << " history rows for account " << account_id;
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to get history columns from PostgreSQL: " << e.what();
+    }
+    return columns;
+}
+
 std::vector<transaction::Transaction> 
 TransactionHistoryService::GetRecentTransactions(
     const std::string& account_id,
@@ -98,8 +215,8 @@ TransactionHistoryService::GetRecentTransactions(
     int limit) const {
     std::vector<transaction::Transaction> recent;
     try {
-        auto result = pg_cluster_->Execute(
-            userver::storages::postgres::ClusterHostType::kSlave,
+        auto result = ExecuteRead(
+            "sender_account", account_id,
             "SELECT transaction_id, sender_account, EXTRACT(EPOCH FROM times_tamp)::bigint as timestamp, "
             "receiver_account, amount::double precision as amount, transaction_type::text, merchant_category, location, "
             "device_used::text, payment_channel::text, ip_address, device_hash "
@@ -141,62 +258,263 @@ TransactionHistoryService::GetRecentTransactions(
     return recent;
 }
 
-float TransactionHistoryService::ExecuteAggregateQuery(const std::string& sql, const std::string& param) const {
-    return ExecuteAggregateQuery(sql, std::vector<std::string>{param});
+std::optional<std::vector<transaction::Transaction>> TransactionHistoryService::GetTransactionsSince(
+    const std::string& account_id,
+    int64_t since_timestamp) const {
+    std::vector<transaction::Transaction> transactions;
+    try {
+        auto result = ExecuteRead(
+            "sender_account", account_id,
+            "SELECT EXTRACT(EPOCH FROM times_tamp)::bigint as timestamp, receiver_account, "
+            "merchant_category, location, ip_address, device_hash "
+            "FROM transactions "
+            "WHERE sender_account = $1 AND times_tamp >= to_timestamp($2)",
+            account_id,
+            since_timestamp
+        );
+        transactions.reserve(result.Size());
+        for (const auto& row : result) {
+            transaction::Transaction tx;
+            tx.set_sender_account(account_id);
+            tx.set_timestamp(std::to_string(row["timestamp"].As<int64_t>()));
+            tx.set_receiver_account(row["receiver_account"].As<std::string>());
+            tx.set_merchant_category(row["merchant_category"].As<std::string>());
+            tx.set_location(row["location"].As<std::string>());
+            tx.set_ip_address(row["ip_address"].As<std::string>());
+            tx.set_device_hash(row["device_hash"].As<std::string>());
+            transactions.push_back(std::move(tx));
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to get transactions since " << since_timestamp
+                    << " from PostgreSQL: " << e.what();
+        return std::nullopt;
+    }
+    return transactions;
+}
+
+std::optional<std::vector<transaction::Transaction>> TransactionHistoryService::GetTransactionsByKey(
+    const std::string& column,
+    const std::string& key,
+    int64_t since_timestamp,
+    size_t limit) const {
+    std::vector<transaction::Transaction> transactions;
+    try {
+        auto result = ExecuteRead(
+            column, key,
+            "SELECT transaction_id, sender_account, EXTRACT(EPOCH FROM times_tamp)::bigint as timestamp, "
+            "receiver_account, amount::double precision as amount, merchant_category, location, "
+            "ip_address, device_hash "
+            "FROM transactions "
+            "WHERE " + column + " = $1 AND times_tamp >= to_timestamp($2) "
+            "ORDER BY times_tamp DESC "
+            "LIMIT $3",
+            key,
+            since_timestamp,
+            static_cast<int64_t>(limit)
+        );
+        transactions.reserve(result.Size());
+        for (const auto& row : result) {
+            transaction::Transaction tx;
+            tx.set_transaction_id(row["transaction_id"].As<std::string>());
+            tx.set_sender_account(row["sender_account"].As<std::string>());
+            tx.set_timestamp(std::to_string(row["timestamp"].As<int64_t>()));
+            tx.set_receiver_account(row["receiver_account"].As<std::string>());
+            tx.set_amount(row["amount"].As<double>());
+            tx.set_merchant_category(row["merchant_category"].As<std::string>());
+            tx.set_location(row["location"].As<std::string>());
+            tx.set_ip_address(row["ip_address"].As<std::string>());
+            tx.set_device_hash(row["device_hash"].As<std::string>());
+            transactions.push_back(std::move(tx));
+        }
+        std::reverse(transactions.begin(), transactions.end());
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to get transactions by " << column << " from PostgreSQL: " << e.what();
+        return std::nullopt;
+    }
+    return transactions;
 }
 
-float TransactionHistoryService::ExecuteAggregateQuery(const std::string& sql, const std::vector<std::string>& params) const {
+std::vector<std::string> TransactionHistoryService::GetMostActiveAccounts(
+    int limit,
+    int hours) const {
+    std::vector<std::string> accounts;
     try {
-        LOG_DEBUG() << "ExecuteAggregateQuery SQL: " << sql;
-        for (size_t i = 0; i < params.size(); ++i) {
-            LOG_DEBUG() << "  param[" << (i+1) << "] = " << params[i];
+        auto result = pg_cluster_->Execute(
+            userver::storages::postgres::ClusterHostType::kSlave,
+            "SELECT sender_account "
+            "FROM transactions "
+            "WHERE times_tamp >= NOW() - INTERVAL '1 hour' * $2 "
+            "GROUP BY sender_account "
+            "ORDER BY COUNT(*) DESC "
+            "LIMIT $1",
+            limit,
+            hours
+        );
+        accounts.reserve(result.Size());
+        for (const auto& row : result) {
+            accounts.push_back(row["sender_account"].As<std::string>());
         }
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to get most active accounts from PostgreSQL: " << e.what();
+    }
+    return accounts;
+}
 
-        userver::storages::postgres::ResultSet result_set =
-            [&]() -> userver::storages::postgres::ResultSet {
-                switch (params.size()) {
-                    case 1:
-                        return pg_cluster_->Execute(userver::storages::postgres::ClusterHostType::kMaster, sql, params[0]);
-                    case 3:
-                        return pg_cluster_->Execute(userver::storages::postgres::ClusterHostType::kMaster, sql, params[0], params[1], params[2]);
-                    case 4:
-                        return pg_cluster_->Execute(userver::storages::postgres::ClusterHostType::kMaster, sql, params[0], params[1], params[2], params[3]);
-                    default:
-                        throw std::runtime_error("Unsupported number of parameters for ExecuteAggregateQuery");
-                }
-            }();
-
-        if (result_set.IsEmpty()) {
-            LOG_DEBUG() << "ExecuteAggregateQuery: result set is empty";
-            return 0.0f;
+void TransactionHistoryService::MaintainPartitions(
+    int days_ahead,
+    int retention_days) const {
+    try {
+        pg_cluster_->Execute(
+            userver::storages::postgres::ClusterHostType::kMaster,
+            "SELECT transactions_maintain_partitions($1, $2)",
+            days_ahead,
+            retention_days
+        );
+        LOG_INFO() << "Maintained transaction partitions (" << days_ahead
+                   << " days ahead, " << retention_days << " days retention)";
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to maintain transaction partitions: " << e.what();
+    }
+}
+
+AmountAggregate TransactionHistoryService::GetAmountAggregate(
+    const std::string& account_id,
+    int64_t since_timestamp) const {
+    return amount_aggregate_flights_.Run(
+        FlightKey(write_generations_.Get("sender_account", account_id), account_id, since_timestamp),
+        [this, account_id, since_timestamp] { return FetchAmountAggregate(account_id, since_timestamp); });
+}
+
+AmountAggregate TransactionHistoryService::FetchAmountAggregate(
+    const std::string& account_id,
+    int64_t since_timestamp) const {
+    AmountAggregate aggregate;
+    try {
+        auto result = ExecuteRead(
+            "sender_account", account_id,
+            "WITH bounds AS ("
+            "  SELECT start_ts, "
+            "         date_trunc('minute', start_ts - INTERVAL '1 microsecond') + INTERVAL '1 minute' AS minute_edge, "
+            "         date_trunc('hour', start_ts - INTERVAL '1 microsecond') + INTERVAL '1 hour' AS hour_edge "
+            "  FROM (SELECT to_timestamp($2)::timestamp AS start_ts) s"
+            "), parts AS ("
+            "  SELECT COUNT(*)::bigint AS tx_count, SUM(amount) AS amount_sum, "
+            "         MIN(amount) AS amount_min, MAX(amount) AS amount_max "
+            "  FROM transactions, bounds "
+            "  WHERE sender_account = $1 AND times_tamp >= start_ts AND times_tamp < minute_edge "
+            "  UNION ALL "
+            "  SELECT SUM(tx_count)::bigint, SUM(amount_sum), MIN(amount_min), MAX(amount_max) "
+            "  FROM transaction_rollups_minute, bounds "
+            "  WHERE sender_account = $1 AND bucket_start >= minute_edge AND bucket_start < hour_edge "
+            "  UNION ALL "
+            "  SELECT SUM(tx_count)::bigint, SUM(amount_sum), MIN(amount_min), MAX(amount_max) "
+            "  FROM transaction_rollups_hour, bounds "
+            "  WHERE sender_account = $1 AND bucket_start >= hour_edge"
+            ") "
+            "SELECT COALESCE(SUM(tx_count), 0)::bigint AS tx_count, "
+            "       COALESCE(SUM(amount_sum), 0)::double precision AS amount_sum, "
+            "       MIN(amount_min)::double precision AS amount_min, "
+            "       MAX(amount_max)::double precision AS amount_max "
+            "FROM parts",
+            account_id,
+            since_timestamp
+        );
+        if (!result.IsEmpty()) {
+            const auto row = result[0];
+            aggregate.count = row["tx_count"].As<int64_t>();
+            aggregate.sum = row["amount_sum"].As<double>();
+            if (!row["amount_min"].IsNull()) {
+                aggregate.min = row["amount_min"].As<double>();
+                aggregate.max = row["amount_max"].As<double>();
+            }
         }
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "Failed to get amount aggregate from rollups: " << e.what();
+    }
+    return aggregate;
+}
 
-        if (result_set[0][0].IsNull()) {
-            LOG_DEBUG() << "ExecuteAggregateQuery: aggregate result is NULL (empty set), returning 0.0f";
-            return 0.0f;
+double TransactionHistoryService::ExecuteAggregate(
+    const userver::storages::postgres::Query& query,
+    std::string_view key_column,
+    const std::string& account_id,
+    int64_t since_timestamp,
+    std::optional<int64_t> limit,
+    AggregateUpdate update) const {
+    if (aggregate_cache_) {
+        since_timestamp = aggregate_cache_->BucketSince(since_timestamp);
+    }
+    // The cache tracks writes itself, so its key carries no write generation.
+    const auto cache_query =
+        FlightKey(0, query.Statement(), since_timestamp, limit ? std::to_string(*limit) : "");
+    uint64_t cache_generation = 0;
+    if (aggregate_cache_) {
+        cache_generation = aggregate_cache_->Generation(key_column, account_id);
+        if (auto cached = aggregate_cache_->Get(key_column, account_id, cache_query)) {
+            return *cached;
         }
+    }
+
+    const auto value = aggregate_flights_.Run(
+        FlightKey(write_generations_.Get(key_column, account_id), query.Statement(), account_id, since_timestamp,
+                  limit ? std::to_string(*limit) : ""),
+        [this, query, key_column, account_id, since_timestamp, limit] {
+            return FetchAggregate(query, key_column, account_id, since_timestamp, limit);
+        });
+    if (!value) {
+        return 0.0;
+    }
+    if (aggregate_cache_) {
+        aggregate_cache_->Put(
+            key_column, account_id, cache_query,
+            AggregateResultCache::Result{*value, since_timestamp, limit ? AggregateUpdate::kNone : update},
+            cache_generation);
+    }
+    return *value;
+}
 
-        try {
-            int64_t ival = result_set[0][0].As<int64_t>();
-            LOG_DEBUG() << "ExecuteAggregateQuery: raw int64 result = " << ival;
-            return static_cast<float>(ival);
-        } catch (...) {}
-        try {
-            double dval = result_set[0][0].As<double>();
-            LOG_DEBUG() << "ExecuteAggregateQuery: raw double result = " << dval;
-            return static_cast<float>(dval);
-        } catch (...) {}
-        try {
-            float fval = result_set[0][0].As<float>();
-            LOG_DEBUG() << "ExecuteAggregateQuery: raw float result = " << fval;
-            return fval;
-        } catch (...) {}
-
-        LOG_DEBUG() << "ExecuteAggregateQuery: unknown type for aggregate column, returning 0.0f";
-        return 0.0f;
+std::optional<double> TransactionHistoryService::FetchAggregate(
+    const userver::storages::postgres::Query& query,
+    std::string_view key_column,
+    const std::string& account_id,
+    int64_t since_timestamp,
+    std::optional<int64_t> limit) const {
+    try {
+        const userver::storages::postgres::TimePointTz since{
+            std::chrono::system_clock::time_point{std::chrono::seconds{since_timestamp}}};
+        auto result = ExecuteRead(
+            key_column, account_id,
+            query,
+            account_id,
+            since,
+            limit
+        );
+        if (result.IsEmpty() || result[0][0].IsNull()) {
+            return 0.0;
+        }
+        return result[0][0].As<double>();
     } catch (const std::exception& e) {
         LOG_ERROR() << "Failed to execute aggregate SQL: " << e.what();
-        return 0.0f;
+        return std::nullopt;
+    }
+}
+
+void TransactionHistoryService::WriteStatistics(userver::utils::statistics::Writer& writer) const {
+    auto account_history = writer["account_history"];
+    account_history_flights_.WriteStatistics(account_history);
+    auto history_columns = writer["history_columns"];
+    history_columns_flights_.WriteStatistics(history_columns);
+    auto amount_aggregate = writer["amount_aggregate"];
+    amount_aggregate_flights_.WriteStatistics(amount_aggregate);
+    auto pattern_aggregate = writer["pattern_aggregate"];
+    aggregate_flights_.WriteStatistics(pattern_aggregate);
+    if (aggregate_cache_) {
+        auto cache = writer["aggregate_cache"];
+        aggregate_cache_->WriteStatistics(cache);
+    }
+    if (read_router_) {
+        auto replica_reads = writer["replica_reads"];
+        read_router_->WriteStatistics(replica_reads);
     }
 }
 
@@ -1,30 +1,133 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <atomic>
 #include <chrono>
 #include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/query.hpp>
 #include <transaction/transaction.pb.h>
 
+#include "transaction_history/aggregate_result_cache.hpp"
+#include "transaction_history/history_columns.hpp"
+#include "transaction_history/replica_read_router.hpp"
+#include "transaction_history/single_flight.hpp"
+#include "transaction_history/write_generations.hpp"
+
 namespace fraud_detection {
 
+// Amount statistics of an account's transactions since some moment.
+struct AmountAggregate {
+    int64_t count = 0;
+    double sum = 0.0;
+    std::optional<double> min;
+    std::optional<double> max;
+};
+
 class TransactionHistoryService {
 public:
+    // With a read router history and aggregate reads go to a replica that
+    // already shows the transactions saved here, see ReplicaReadRouter;
+    // without one they go to the master.
+    // With an aggregate cache ExecuteAggregate results are reused within its
+    // TTL; transactions saved here patch or drop the results of their keys.
     explicit TransactionHistoryService(
-        userver::storages::postgres::ClusterPtr pg_cluster);
+        userver::storages::postgres::ClusterPtr pg_cluster,
+        std::shared_ptr<ReplicaReadRouter> read_router = nullptr,
+        std::shared_ptr<AggregateResultCache> aggregate_cache = nullptr);
     virtual ~TransactionHistoryService() = default;
     virtual void SaveTransaction(const transaction::Transaction& tx);
     virtual std::vector<transaction::Transaction> GetAccountHistory(
         const std::string& account_id, 
         int limit = 100) const;
+    // The last `limit` transactions of the account before `before_timestamp`,
+    // newest first, projected to the columns the ML account stats need.
+    virtual HistoryColumns GetAccountHistoryColumns(
+        const std::string& account_id,
+        int64_t before_timestamp,
+        int limit = 1000) const;
     virtual std::vector<transaction::Transaction> GetRecentTransactions(
         const std::string& account_id,
         int minutes,
         int limit = 100) const;
+    // Transactions of the account since `since_timestamp`, unordered, or
+    // std::nullopt if the query failed. Only the fields tracked by distinct
+    // sketches are filled in.
+    std::optional<std::vector<transaction::Transaction>> GetTransactionsSince(
+        const std::string& account_id,
+        int64_t since_timestamp) const;
+    // The newest `limit` transactions whose `column` equals `key` since
+    // `since_timestamp`, ordered by time, or std::nullopt if the query failed.
+    // `column` must be one of the text columns of the transactions table, see
+    // KeyedWindowStore::ColumnName.
+    std::optional<std::vector<transaction::Transaction>> GetTransactionsByKey(
+        const std::string& column,
+        const std::string& key,
+        int64_t since_timestamp,
+        size_t limit) const;
+    std::vector<std::string> GetMostActiveAccounts(int limit, int hours) const;
+    // Precreates daily partitions of the transactions table and drops the
+    // ones older than the retention window (see 003_partition_transactions.sql).
+    void MaintainPartitions(int days_ahead, int retention_days) const;
+    // Answers amount aggregates from the hour and minute rollups, scanning raw
+    // rows only for the partial minute after `since_timestamp`.
+    AmountAggregate GetAmountAggregate(
+        const std::string& account_id,
+        int64_t since_timestamp) const;
+
+    // Runs an aggregate query prepared by a pattern rule. The query takes the
+    // value of `key_column` (the sender account unless grouped), the window
+    // start and an optional row limit, and returns a single double precision
+    // column. With an aggregate cache the window start is rounded down to its
+    // bucket, and `update` tells how a cached result follows later saves.
+    double ExecuteAggregate(
+        const userver::storages::postgres::Query& query,
+        std::string_view key_column,
+        const std::string& key,
+        int64_t since_timestamp,
+        std::optional<int64_t> limit,
+        AggregateUpdate update = AggregateUpdate::kNone) const;
 
-    float ExecuteAggregateQuery(const std::string& sql, const std::string& param) const;
-    float ExecuteAggregateQuery(const std::string& sql, const std::vector<std::string>& params) const;
+    // Single-flight metrics of the coalesced reads: GetAccountHistory,
+    // GetAccountHistoryColumns, GetAmountAggregate and ExecuteAggregate.
+    // Concurrent calls with identical arguments share one database query.
+    // Also the aggregate cache and replica read metrics when they are enabled.
+    void WriteStatistics(userver::utils::statistics::Writer& writer) const;
 private:
+    std::vector<transaction::Transaction> FetchAccountHistory(
+        const std::string& account_id,
+        int limit) const;
+    HistoryColumns FetchAccountHistoryColumns(
+        const std::string& account_id,
+        int64_t before_timestamp,
+        int limit) const;
+    AmountAggregate FetchAmountAggregate(
+        const std::string& account_id,
+        int64_t since_timestamp) const;
+    std::optional<double> FetchAggregate(
+        const userver::storages::postgres::Query& query,
+        std::string_view key_column,
+        const std::string& account_id,
+        int64_t since_timestamp,
+        std::optional<int64_t> limit) const;
+
+    // Runs a read of the rows whose `column` equals `key` through the read
+    // router, or on the master without one.
+    template <typename... Args>
+    userver::storages::postgres::ResultSet ExecuteRead(
+        std::string_view column,
+        const std::string& key,
+        const userver::storages::postgres::Query& query,
+        const Args&... args) const {
+        if (read_router_) {
+            return read_router_->Execute(column, key, query, args...);
+        }
+        return pg_cluster_->Execute(userver::storages::postgres::ClusterHostType::kMaster, query, args...);
+    }
+
     std::string TransactionTypeToString(transaction::Transaction::TransactionType type) const;
     std::string DeviceUsedToString(transaction::Transaction::DeviceUsed device) const;
     std::string PaymentChannelToString(transaction::Transaction::PaymentChannel channel) const;
@@ -32,8 +135,17 @@ private:
     transaction::Transaction::TransactionType StringToTransactionType(const std::string& str) const;
     transaction::Transaction::DeviceUsed StringToDeviceUsed(const std::string& str) const;
     transaction::Transaction::PaymentChannel StringToPaymentChannel(const std::string& str) const;
-    
+
+
     userver::storages::postgres::ClusterPtr pg_cluster_;
+    std::shared_ptr<ReplicaReadRouter> read_router_;
+    std::shared_ptr<AggregateResultCache> aggregate_cache_;
+
+    WriteGenerations write_generations_;
+    mutable SingleFlight<std::vector<transaction::Transaction>> account_history_flights_;
+    mutable SingleFlight<HistoryColumns> history_columns_flights_;
+    mutable SingleFlight<AmountAggregate> amount_aggregate_flights_;
+    mutable SingleFlight<std::optional<double>> aggregate_flights_;
 };
 
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include <transaction/transaction.pb.h>
+
+namespace fraud_detection {
+
+// Write counters per group key (a column of the transactions table and its
+// value), striped over a fixed number of slots. Saving a transaction moves
+// the slots of its own keys only, so reads of other accounts keep sharing
+// in-flight queries and cache fills; keys that share a slot merely see a
+// few extra moves.
+class WriteGenerations {
+public:
+    uint64_t Get(std::string_view column, std::string_view key) const {
+        return slots_[Slot(column, key)].load();
+    }
+
+    // Moves the slot of every key field of `tx`.
+    void Bump(const transaction::Transaction& tx) {
+        for (const auto& [column, key] : {
+                 std::pair<std::string_view, std::string_view>{"sender_account", tx.sender_account()},
+                 {"receiver_account", tx.receiver_account()},
+                 {"merchant_category", tx.merchant_category()},
+                 {"location", tx.location()},
+                 {"ip_address", tx.ip_address()},
+                 {"device_hash", tx.device_hash()}}) {
+            if (!key.empty()) {
+                ++slots_[Slot(column, key)];
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kSlots = 4096;
+
+    static size_t Slot(std::string_view column, std::string_view key) {
+        const auto hash = std::hash<std::string_view>{}(key) * 31 + std::hash<std::string_view>{}(column);
+        return hash % kSlots;
+    }
+
+    std::array<std::atomic<uint64_t>, kSlots> slots_{};
+};
+
+}  // namespace fraud_detection
@@ -0,0 +1,219 @@
+"""Compiles an XGBoost JSON model into a shared object for MLFraudDetector.
+
+    python3 tools/compile_tree_model.py model_configs/<uuid>_json.json
+
+writes <uuid>_compiled.cpp and <uuid>_compiled.so next to the model, or into
+--output-dir (the detector's ml_model_artifact_dir). Every
+tree becomes a function of nested if-else on the feature vector, so a
+prediction is a chain of predictable compares instead of XGBoost's generic
+tree walk. The detector picks up <uuid>_compiled.so on load and falls back
+to the XGBoost C API when it is missing or does not match the model.
+
+Exported C symbols:
+    int fraud_model_num_features();
+    double fraud_model_predict(const float* features);
+
+With --binary it also writes <uuid>_trees.bin, the read-only form that the
+detector maps with mmap when no compiled model is available. All replicas
+on a host share its pages. Layout, little-endian (see mapped_tree_model.hpp):
+    header  magic "FTM1", version, num_features, num_trees, num_nodes,
+            transform (0 identity, 1 logistic), base_margin, missing
+    roots   uint32 per tree, index of the root node
+    nodes   value (float), feature (uint32, high bit: default left),
+            left, right (uint32 node indices, left = 0xFFFFFFFF on leaves)
+"""
+
+import argparse
+import json
+import math
+import os
+import struct
+import subprocess
+import sys
+
+BINARY_MAGIC = b'FTM1'
+BINARY_VERSION = 1
+LEAF = 0xFFFFFFFF
+DEFAULT_LEFT = 0x80000000
+
+SUPPORTED_OBJECTIVES = {
+    'binary:logistic': 'logistic',
+    'reg:logistic': 'logistic',
+    'binary:logitraw': 'identity',
+    'reg:squarederror': 'identity',
+}
+
+
+def parse_float(value):
+    # XGBoost >= 2 stores base_score as a vector: "[5E-1]".
+    if isinstance(value, str):
+        value = value.strip('[]').split(',')[0]
+    return float(value)
+
+
+def float_literal(value):
+    if math.isinf(value):
+        return '-INFINITY' if value < 0 else 'INFINITY'
+    return repr(float(value)) + 'f'
+
+
+def emit_tree(tree, index, missing, out):
+    left = tree['left_children']
+    right = tree['right_children']
+    split_index = tree['split_indices']
+    split_condition = tree['split_conditions']
+    default_left = tree['default_left']
+
+    out.append(f'float tree_{index}(const float* f) {{')
+
+    def node(nid, depth):
+        pad = '    ' * depth
+        if left[nid] == -1:
+            out.append(f'{pad}return {float_literal(split_condition[nid])};')
+            return
+        feature = f'f[{split_index[nid]}]'
+        is_missing = f'std::isnan({feature})'
+        if missing is not None:
+            is_missing += f' || {feature} == {float_literal(missing)}'
+        if default_left[nid]:
+            condition = f'{is_missing} || {feature} < {float_literal(split_condition[nid])}'
+        else:
+            condition = f'!({is_missing}) && {feature} < {float_literal(split_condition[nid])}'
+        out.append(f'{pad}if ({condition}) {{')
+        node(left[nid], depth + 1)
+        out.append(f'{pad}}} else {{')
+        node(right[nid], depth + 1)
+        out.append(f'{pad}}}')
+
+    node(0, 1)
+    out.append('}')
+    out.append('')
+
+
+def model_params(model):
+    learner = model['learner']
+    objective = learner['objective']['name']
+    if objective not in SUPPORTED_OBJECTIVES:
+        raise ValueError(f'objective {objective} is not supported')
+    params = learner['learner_model_param']
+    if int(params.get('num_class', '0')) > 1 or int(params.get('num_target', '1')) > 1:
+        raise ValueError('multi-class and multi-target models are not supported')
+    booster = learner['gradient_booster']
+    if booster['name'] != 'gbtree':
+        raise ValueError(f'booster {booster["name"]} is not supported')
+
+    num_features = int(params['num_feature'])
+    base_score = parse_float(params['base_score'])
+    transform = SUPPORTED_OBJECTIVES[objective]
+    base_margin = math.log(base_score / (1.0 - base_score)) if transform == 'logistic' else base_score
+    trees = booster['model']['trees']
+    for index, tree in enumerate(trees):
+        if any(split_type != 0 for split_type in tree.get('split_type', [])):
+            raise ValueError(f'tree {index} has categorical splits, which are not supported')
+    return num_features, transform, base_margin, trees
+
+
+def generate(model, missing):
+    num_features, transform, base_margin, trees = model_params(model)
+
+    out = [
+        '// Generated by tools/compile_tree_model.py, do not edit.',
+        '#include <cmath>',
+        '',
+        'namespace {',
+        '',
+    ]
+    for index, tree in enumerate(trees):
+        emit_tree(tree, index, missing, out)
+    out.append('} // anonymous namespace')
+    out.append('')
+    out.append(f'extern "C" int fraud_model_num_features() {{ return {num_features}; }}')
+    out.append('')
+    out.append('extern "C" double fraud_model_predict(const float* f) {')
+    out.append(f'    float margin = {float_literal(base_margin)};')
+    for index in range(len(trees)):
+        out.append(f'    margin += tree_{index}(f);')
+    if transform == 'logistic':
+        out.append('    return 1.0f / (1.0f + std::exp(-margin));')
+    else:
+        out.append('    return margin;')
+    out.append('}')
+    out.append('')
+    return '\n'.join(out)
+
+
+def generate_binary(model, missing):
+    num_features, transform, base_margin, trees = model_params(model)
+
+    roots = []
+    nodes = []
+    for tree in trees:
+        base = len(nodes)
+        roots.append(base)
+        for nid, left in enumerate(tree['left_children']):
+            if left == -1:
+                nodes.append((tree['split_conditions'][nid], 0, LEAF, LEAF))
+                continue
+            feature = tree['split_indices'][nid]
+            if tree['default_left'][nid]:
+                feature |= DEFAULT_LEFT
+            nodes.append((tree['split_conditions'][nid], feature, base + left, base + tree['right_children'][nid]))
+
+    out = bytearray()
+    out += BINARY_MAGIC
+    out += struct.pack('<IIIIIff', BINARY_VERSION, num_features, len(trees), len(nodes),
+                       1 if transform == 'logistic' else 0, base_margin,
+                       math.nan if missing is None else missing)
+    out += struct.pack(f'<{len(roots)}I', *roots)
+    out += bytes(-len(out) % 16)
+    for node in nodes:
+        out += struct.pack('<fIII', *node)
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('model', help='XGBoost JSON model, <uuid>_json.json')
+    parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'), help='C++ compiler')
+    parser.add_argument('--missing', type=float, default=0.0,
+                        help='value treated as missing, must match the DMatrix of the detector (0.0)')
+    parser.add_argument('--no-missing', action='store_true', help='treat only NaN as missing')
+    parser.add_argument('--source-only', action='store_true', help='write the .cpp without building it')
+    parser.add_argument('--binary', action='store_true', help='also write the mmap-able <uuid>_trees.bin')
+    parser.add_argument('--output-dir', help='directory for the generated files (next to the model)')
+    args = parser.parse_args()
+
+    suffix = '_json.json'
+    if not args.model.endswith(suffix):
+        sys.exit(f'{args.model}: expected a <uuid>{suffix} model')
+    prefix = args.model[:-len(suffix)]
+    if args.output_dir:
+        os.makedirs(args.output_dir, exist_ok=True)
+        prefix = os.path.join(args.output_dir, os.path.basename(prefix))
+    source_path = prefix + '_compiled.cpp'
+    library_path = prefix + '_compiled.so'
+
+    with open(args.model) as model_file:
+        model = json.load(model_file)
+    try:
+        source = generate(model, None if args.no_missing else args.missing)
+    except ValueError as e:
+        sys.exit(f'{args.model}: {e}')
+    with open(source_path, 'w') as source_file:
+        source_file.write(source)
+    print(f'Wrote {source_path}')
+
+    if args.binary:
+        binary_path = prefix + '_trees.bin'
+        with open(binary_path, 'wb') as binary_file:
+            binary_file.write(generate_binary(model, None if args.no_missing else args.missing))
+        print(f'Wrote {binary_path}')
+
+    if args.source_only:
+        return
+    subprocess.run([args.cxx, '-O2', '-shared', '-fPIC', '-o', library_path, source_path], check=True)
+    print(f'Built {library_path}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,118 @@
+-- Daily range partitioning of transactions by times_tamp.
+-- History and aggregate queries filter on sender_account and order by
+-- times_tamp, so they are served by a per-partition covering index and only
+-- touch the partitions of the requested window.
+
+ALTER TABLE transactions RENAME TO transactions_unpartitioned;
+
+CREATE TABLE transactions (
+    id BIGINT GENERATED BY DEFAULT AS IDENTITY,
+    transaction_id VARCHAR(255) NOT NULL,
+    sender_account VARCHAR(255) NOT NULL,
+    times_tamp TIMESTAMP NOT NULL,
+    receiver_account VARCHAR(255) NOT NULL,
+    amount NUMERIC NOT NULL,
+    transaction_type transaction_type NOT NULL,
+    merchant_category VARCHAR(255) NOT NULL,
+    location VARCHAR(255) NOT NULL,
+    device_used device_used NOT NULL,
+    payment_channel payment_channel NOT NULL,
+    ip_address VARCHAR(255) NOT NULL,
+    device_hash VARCHAR(255) NOT NULL,
+    PRIMARY KEY (id, times_tamp),
+    -- unique constraints of a partitioned table must include the partition key
+    UNIQUE (transaction_id, times_tamp)
+) PARTITION BY RANGE (times_tamp);
+
+-- catches rows outside of the precreated range until their partition exists
+CREATE TABLE transactions_default PARTITION OF transactions DEFAULT;
+
+CREATE INDEX transactions_sender_time_idx
+    ON transactions (sender_account, times_tamp DESC)
+    INCLUDE (amount, transaction_type, merchant_category, location, device_used, payment_channel,
+             receiver_account, ip_address, device_hash);
+
+-- Creates the daily partition holding `day`, moving matching rows out of the
+-- default partition first so that the attach does not fail.
+CREATE OR REPLACE FUNCTION transactions_create_partition(day DATE) RETURNS VOID AS $$
+DECLARE
+    partition_name TEXT := format('transactions_p%s', to_char(day, 'YYYYMMDD'));
+    range_from TIMESTAMP := day::timestamp;
+    range_to TIMESTAMP := (day + 1)::timestamp;
+BEGIN
+    IF to_regclass(partition_name) IS NOT NULL THEN
+        RETURN;
+    END IF;
+
+    EXECUTE format('CREATE TABLE %I (LIKE transactions INCLUDING DEFAULTS INCLUDING CONSTRAINTS)',
+                   partition_name);
+    EXECUTE format('WITH moved AS (DELETE FROM transactions_default '
+                   'WHERE times_tamp >= %L AND times_tamp < %L RETURNING *) '
+                   'INSERT INTO %I SELECT * FROM moved',
+                   range_from, range_to, partition_name);
+    EXECUTE format('ALTER TABLE transactions ATTACH PARTITION %I FOR VALUES FROM (%L) TO (%L)',
+                   partition_name, range_from, range_to);
+END;
+$$ LANGUAGE plpgsql;
+
+-- Precreates partitions for the next `days_ahead` days and drops partitions
+-- that ended more than `retention_days` days ago, deleting rows of the same
+-- age from the default partition too. Called periodically by rules_service;
+-- the advisory lock serialises concurrent replicas.
+CREATE OR REPLACE FUNCTION transactions_maintain_partitions(
+    days_ahead INT DEFAULT 7,
+    retention_days INT DEFAULT 90
+) RETURNS VOID AS $$
+DECLARE
+    day DATE;
+    partition RECORD;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('transactions_maintain_partitions'));
+
+    FOR day IN SELECT generate_series(current_date - 1, current_date + days_ahead, INTERVAL '1 day')::date LOOP
+        PERFORM transactions_create_partition(day);
+    END LOOP;
+
+    FOR partition IN
+        SELECT child.relname AS name
+        FROM pg_inherits
+        JOIN pg_class parent ON parent.oid = pg_inherits.inhparent
+        JOIN pg_class child ON child.oid = pg_inherits.inhrelid
+        WHERE parent.relname = 'transactions'
+          AND child.relname ~ '^transactions_p[0-9]{8}$'
+          AND to_date(substring(child.relname FROM 15), 'YYYYMMDD') < current_date - retention_days
+    LOOP
+        EXECUTE format('DROP TABLE %I', partition.name);
+    END LOOP;
+
+    DELETE FROM transactions_default
+    WHERE times_tamp < (current_date - retention_days)::timestamp;
+END;
+$$ LANGUAGE plpgsql;
+
+DO $$
+DECLARE
+    day DATE;
+BEGIN
+    FOR day IN
+        SELECT generate_series(
+            LEAST(COALESCE((SELECT min(times_tamp)::date FROM transactions_unpartitioned), current_date),
+                  current_date - 1),
+            current_date + 7,
+            INTERVAL '1 day')::date
+    LOOP
+        PERFORM transactions_create_partition(day);
+    END LOOP;
+END;
+$$;
+
+INSERT INTO transactions (transaction_id, sender_account, times_tamp, receiver_account, amount,
+                          transaction_type, merchant_category, location, device_used, payment_channel,
+                          ip_address, device_hash)
+SELECT transaction_id, sender_account, times_tamp, receiver_account, amount,
+       transaction_type, merchant_category, location, device_used, payment_channel,
+       ip_address, device_hash
+FROM transactions_unpartitioned
+ON CONFLICT DO NOTHING;
+
+DROP TABLE transactions_unpartitioned;
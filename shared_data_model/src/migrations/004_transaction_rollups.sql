@@ -0,0 +1,68 @@
+-- Per-account minute and hour rollups of transaction amounts.
+-- Maintained by rules_service in the same statement that inserts a batch of
+-- transactions; pattern aggregates over long windows sum the buckets and only
+-- scan raw rows for the partial minute at the start of the window.
+
+CREATE TABLE IF NOT EXISTS transaction_rollups_minute (
+    sender_account VARCHAR(255) NOT NULL,
+    bucket_start TIMESTAMP NOT NULL,
+    tx_count BIGINT NOT NULL,
+    amount_sum NUMERIC NOT NULL,
+    amount_min NUMERIC NOT NULL,
+    amount_max NUMERIC NOT NULL,
+    PRIMARY KEY (sender_account, bucket_start)
+);
+
+CREATE TABLE IF NOT EXISTS transaction_rollups_hour (
+    sender_account VARCHAR(255) NOT NULL,
+    bucket_start TIMESTAMP NOT NULL,
+    tx_count BIGINT NOT NULL,
+    amount_sum NUMERIC NOT NULL,
+    amount_min NUMERIC NOT NULL,
+    amount_max NUMERIC NOT NULL,
+    PRIMARY KEY (sender_account, bucket_start)
+);
+
+INSERT INTO transaction_rollups_minute
+SELECT sender_account, date_trunc('minute', times_tamp), COUNT(*), SUM(amount), MIN(amount), MAX(amount)
+FROM transactions
+GROUP BY 1, 2
+ON CONFLICT DO NOTHING;
+
+INSERT INTO transaction_rollups_hour
+SELECT sender_account, date_trunc('hour', times_tamp), COUNT(*), SUM(amount), MIN(amount), MAX(amount)
+FROM transactions
+GROUP BY 1, 2
+ON CONFLICT DO NOTHING;
+
+-- Same as in 003, additionally expiring rollup buckets with the partitions.
+CREATE OR REPLACE FUNCTION transactions_maintain_partitions(
+    days_ahead INT DEFAULT 7,
+    retention_days INT DEFAULT 90
+) RETURNS VOID AS $$
+DECLARE
+    day DATE;
+    partition RECORD;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('transactions_maintain_partitions'));
+
+    FOR day IN SELECT generate_series(current_date - 1, current_date + days_ahead, INTERVAL '1 day')::date LOOP
+        PERFORM transactions_create_partition(day);
+    END LOOP;
+
+    FOR partition IN
+        SELECT child.relname AS name
+        FROM pg_inherits
+        JOIN pg_class parent ON parent.oid = pg_inherits.inhparent
+        JOIN pg_class child ON child.oid = pg_inherits.inhrelid
+        WHERE parent.relname = 'transactions'
+          AND child.relname ~ '^transactions_p[0-9]{8}$'
+          AND to_date(substring(child.relname FROM 15), 'YYYYMMDD') < current_date - retention_days
+    LOOP
+        EXECUTE format('DROP TABLE %I', partition.name);
+    END LOOP;
+
+    DELETE FROM transaction_rollups_minute WHERE bucket_start < current_date - retention_days;
+    DELETE FROM transaction_rollups_hour WHERE bucket_start < current_date - retention_days;
+END;
+$$ LANGUAGE plpgsql;
@@ -0,0 +1,12 @@
+-- Indexes for pattern aggregates grouped by a field other than the sender,
+-- e.g. every transaction from one device or IP address in the last hour.
+-- Created on the partitioned table, so every daily partition gets them.
+
+CREATE INDEX IF NOT EXISTS transactions_receiver_time_idx
+    ON transactions (receiver_account, times_tamp DESC);
+
+CREATE INDEX IF NOT EXISTS transactions_device_hash_time_idx
+    ON transactions (device_hash, times_tamp DESC);
+
+CREATE INDEX IF NOT EXISTS transactions_ip_address_time_idx
+    ON transactions (ip_address, times_tamp DESC);
@@ -0,0 +1,10 @@
+-- Indexes for keyed windows and pattern aggregates grouped by merchant
+-- category or location, the remaining group-by fields without one (see
+-- 005_transaction_key_indexes.sql). Both keys are low-cardinality, so reads
+-- take the newest rows of a key through times_tamp DESC with a LIMIT.
+
+CREATE INDEX IF NOT EXISTS transactions_merchant_category_time_idx
+    ON transactions (merchant_category, times_tamp DESC);
+
+CREATE INDEX IF NOT EXISTS transactions_location_time_idx
+    ON transactions (location, times_tamp DESC);